@@ -25,6 +25,7 @@
 #include <json.hpp>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/eventfd.h>
 #include <mqueue.h>
 #include <filesystem>
 #include <memory>
@@ -36,6 +37,8 @@ class DeviceServerParameter {
     bool display_version{ };
     bool log_debug_mode{ };
     int thread_count{ };
+    bool sharded{ };
+    int max_batch{ };
 
     bool valid{ };
 
@@ -50,6 +53,8 @@ public:
                 {'l', "log_file", "file path", "Path to save log file", log_file, std::filesystem::path("/tmp/iotcloud/log/deviceserver.log")},
                 {'c', "config_folder", "folder path", "Path to configuration folder, it must contain file iot.json and logmodule.json", config_folder, "/etc/iotcloud"},
                 {'t', "thread_count", "number of thread", "Number of threads that listen to socket, 0 means number of CPU", thread_count, 0},
+                {'b', "max_batch", "number of events", "Maximum events processed per epoll wakeup, batch adapts between 1 and this value", max_batch, rohit::config::event_dist_max_batch},
+                {'s', "sharded", "Each thread has its own epoll and listening socket, connection stays on accepting thread", sharded},
                 {'v', "version", "Display version", display_version},
                 {'d', "debug", "Dumps all the logs, logs file will be very big", log_debug_mode}
             }
@@ -72,6 +77,8 @@ public:
     auto GetIsDisplayVersion() const { return display_version; }
     auto GetIsLogDebugMode() const { return log_debug_mode; }
     auto GetThreadCount() const { return thread_count; }
+    auto GetIsSharded() const { return sharded; }
+    auto GetMaxBatch() const { return max_batch; }
 };
 
 class DeviceServer {
@@ -80,6 +87,8 @@ class DeviceServer {
     typedef rohit::serverevent<rohit::iothttpevent<false>, false> httpevent_type;
     typedef rohit::serverevent<rohit::iothttpsslevent, true> httpevent_ssl_type;
 
+    static constexpr int default_maxconnection = 10000;
+
     std::unique_ptr<rohit::event_distributor> evtdist;
     std::vector<std::unique_ptr<serverevent_type>> srvevts;
     std::vector<std::unique_ptr<serverevent_ssl_type>> srvevts_ssl;
@@ -90,20 +99,31 @@ class DeviceServer {
 
     const DeviceServerParameter &parameter;
 
+    // Connections still open after this are force closed on shutdown
+    int drain_timeout_in_ms { rohit::config::event_dist_drain_timeout_in_ms };
+
 public:
     DeviceServer(const DeviceServerParameter &parameter) : parameter{ parameter } {
+        const auto str_config_folder = parameter.GetConfigurationFolder();
+        const auto configfile = str_config_folder + "/iot.json";
+        auto config = json::JSON::Load(load_config_string(configfile.c_str()));
+
+        // Placement must be known before loop threads are created
+        const auto placement = load_thread_placement(config);
+        load_drain_timeout(config);
+
         std::cout << "Creating event distributor" << std::endl;
-        evtdist.reset(new rohit::event_distributor(parameter.GetThreadCount()));
+        const auto mode = parameter.GetIsSharded() ? rohit::event_mode_t::SHARDED : rohit::event_mode_t::SHARED;
+        evtdist.reset(new rohit::event_distributor(parameter.GetThreadCount(), mode, parameter.GetMaxBatch(), placement));
         evtdist->init();
+        load_compute(config);
+        load_io_budget(config);
 
         ptr_filewatcher.reset(new rohit::http::httpfilewatcher(*evtdist));
         ptr_filewatcher->init();
 
-        const auto str_config_folder = parameter.GetConfigurationFolder();
-        const auto configfile = str_config_folder + "/iot.json";
-
         // Loading servers
-        load_and_execute_config(configfile);
+        execute_config(config);
     }
 
     void Wait() {
@@ -114,6 +134,10 @@ public:
 
     void destroy_app() {
         if (evtdist) {
+            // Listeners stop accepting, devices are told to reconnect later
+            // and HTTP 2 peers get GOAWAY before loop threads exit
+            std::cout << "Draining connections" << std::endl;
+            evtdist->drain(drain_timeout_in_ms);
             evtdist->terminate();
             std::cout << "Destroying IOT" << std::endl;
             rohit::destroy_iot();
@@ -158,11 +182,87 @@ private:
         return buffer_str;
     }
 
-    void load_and_execute_config(const std::string configfile) {
-        std::string buffer = load_config_string(configfile.c_str());
+    // "eventloop": { "placement": "compact" | "scatter" | "list" | "numa" | "none", "cpus": [ 0, 2 ] }
+    rohit::thread_placement load_thread_placement(json::JSON &config) {
+        rohit::thread_placement placement { };
+        if (!config.hasKey("eventloop")) return placement;
 
-        auto config = json::JSON::Load(buffer);
+        auto eventloop = config["eventloop"];
+        const auto placement_str = eventloop["placement"].ToString();
+        placement.policy = rohit::to_thread_placement(placement_str);
+        if (placement.policy == rohit::thread_placement_t::NONE && !placement_str.empty() && placement_str != "none") {
+            std::cout << "Unknown thread placement " << placement_str << ", threads will not be pinned" << std::endl;
+        }
 
+        if (placement.policy == rohit::thread_placement_t::LIST) {
+            for(auto cpu: eventloop["cpus"].ArrayRange()) {
+                placement.cpu_list.push_back(static_cast<int>(cpu.ToInt()));
+            }
+            if (placement.cpu_list.empty()) {
+                std::cout << "Thread placement list without cpus, threads will not be pinned" << std::endl;
+            }
+        }
+
+        std::cout << "Thread placement " << (placement_str.empty() ? "none" : placement_str) << std::endl;
+        return placement;
+    }
+
+    void load_drain_timeout(json::JSON &config) {
+        if (!config.hasKey("eventloop")) return;
+
+        auto eventloop = config["eventloop"];
+        if (!eventloop.hasKey("drain_timeout")) return;
+        const auto timeout = static_cast<int>(eventloop["drain_timeout"].ToInt());
+        if (timeout > 0) drain_timeout_in_ms = timeout;
+        std::cout << "Drain timeout " << drain_timeout_in_ms << " milliseconds" << std::endl;
+    }
+
+    // "eventloop": { "compute_threads": 2 }, 0 runs CPU heavy jobs inline on loop thread
+    void load_compute(json::JSON &config) {
+        if (!config.hasKey("eventloop")) return;
+
+        auto eventloop = config["eventloop"];
+        if (!eventloop.hasKey("compute_threads")) return;
+        const auto thread_count = static_cast<size_t>(eventloop["compute_threads"].ToInt());
+        if (thread_count == 0) return;
+        evtdist->init_compute(thread_count);
+        std::cout << "Compute threads " << thread_count << std::endl;
+    }
+
+    // "eventloop": { "io_budget": 65536 }, bytes read from one connection before others get a turn
+    void load_io_budget(json::JSON &config) {
+        if (!config.hasKey("eventloop")) return;
+
+        auto eventloop = config["eventloop"];
+        if (!eventloop.hasKey("io_budget")) return;
+        const auto budget = static_cast<size_t>(eventloop["io_budget"].ToInt());
+        evtdist->set_io_budget(budget);
+        std::cout << "IO budget " << budget << " bytes" << std::endl;
+    }
+
+    // Missing keys keep kernel default, device listeners want small buffers
+    // and keepalive, download listeners large buffers and cork
+    rohit::tcp_profile read_tcp_profile(json::JSON &server) {
+        rohit::tcp_profile profile { };
+        if (!server.hasKey("TCP")) return profile;
+        auto tcp = server["TCP"];
+        auto read_int = [&tcp](const char *key) {
+            return tcp.hasKey(key) ? static_cast<int>(std::max(tcp[key].ToInt(), 0L)) : 0;
+        };
+        profile.nodelay = tcp.hasKey("NoDelay") && tcp["NoDelay"].ToBool();
+        profile.cork = tcp.hasKey("Cork") && tcp["Cork"].ToBool();
+        profile.defer_accept_in_s = read_int("DeferAccept");
+        profile.keepalive_idle_in_s = read_int("KeepIdle");
+        profile.keepalive_interval_in_s = read_int("KeepInterval");
+        profile.keepalive_count = read_int("KeepCount");
+        profile.user_timeout_in_ms = read_int("UserTimeout");
+        profile.notsent_lowat = read_int("NotSentLowat");
+        profile.receive_buffer_size = read_int("ReceiveBuffer");
+        profile.send_buffer_size = read_int("SendBuffer");
+        return profile;
+    }
+
+    void execute_config(json::JSON &config) {
         auto servers = config["servers"];
 
         for(auto server: servers.ArrayRange()) {
@@ -170,6 +270,37 @@ private:
             const auto TYPE = server["TYPE"].ToString();
             const auto port = server["port"].ToInt();
 
+            // Busy poll budget in microseconds for latency critical listeners, 0 disables.
+            // Enable only with loop threads on dedicated cores, see config::event_dist_max_busy_poll_in_us
+            const auto busy_poll = static_cast<int>(server["BusyPoll"].ToInt());
+
+            // Admission control, connections over limit or rate get busy reply
+            const auto max_connection_temp = static_cast<int>(server["MaxConnection"].ToInt());
+            const auto max_connection = max_connection_temp > 0 ? max_connection_temp : default_maxconnection;
+            const auto backlog = static_cast<int>(server["Backlog"].ToInt());
+            const auto accept_rate = static_cast<uint64_t>(server["AcceptRate"].ToInt());
+            const auto accept_burst = static_cast<uint64_t>(server["AcceptBurst"].ToInt());
+
+            // Connection stops reading above high and resumes at low queued write bytes, 0 keeps default
+            const auto write_high_watermark = static_cast<size_t>(std::max(server["WriteHighWatermark"].ToInt(), 0L));
+            const auto write_low_watermark = static_cast<size_t>(std::max(server["WriteLowWatermark"].ToInt(), 0L));
+
+            // Kernel TLS for ssl and https, falls back to userspace TLS where unsupported
+            const auto ktls = server.hasKey("KTLS") && server["KTLS"].ToBool();
+
+            // Responses of at least this size are sent with MSG_ZEROCOPY on simple and http, 0 disables
+            const auto zerocopy_min_size = static_cast<size_t>(std::max(server["ZeroCopyMinSize"].ToInt(), 0L));
+
+            // Socket options of listener, inherited by accepted connections
+            const auto profile = read_tcp_profile(server);
+            auto admission = [&](auto *srvevt) {
+                srvevt->set_busy_poll(busy_poll);
+                srvevt->set_backlog(backlog);
+                srvevt->set_accept_rate(accept_rate, accept_burst);
+                srvevt->set_write_watermark(write_high_watermark, write_low_watermark);
+                srvevt->set_tcp_profile(profile);
+            };
+
             if (IP != "*") {
                 std::cout << "Only * is supported for IP address, skipping creation of this server" << std::endl;
                 continue;
@@ -183,7 +314,9 @@ private:
             if (TYPE == "simple") {
                 std::cout << "Creating a server at port " << port << std::endl;
                 auto srvevt =
-                    new serverevent_type(port);
+                    new serverevent_type(port, max_connection, evtdist->is_sharded());
+                admission(srvevt);
+                srvevt->set_zerocopy(zerocopy_min_size);
                 srvevt->init(*evtdist);
                 srvevts.emplace_back(srvevt);
             } else if (TYPE == "ssl") {
@@ -195,7 +328,11 @@ private:
                 auto srvevt_ssl = new serverevent_ssl_type(
                     port,
                     cert_file.c_str(),
-                    prikey_file.c_str());
+                    prikey_file.c_str(),
+                    max_connection,
+                    evtdist->is_sharded());
+                admission(srvevt_ssl);
+                srvevt_ssl->set_ktls(ktls);
                 srvevt_ssl->init(*evtdist);
 
                 srvevts_ssl.emplace_back(srvevt_ssl);
@@ -203,7 +340,9 @@ private:
                 std::cout << "Creating a HTTP server at port " << port << std::endl;
                 auto webfolder = server["Folder"].ToString();
                 rohit::http::webfilemap.add_folder(port, webfolder);
-                auto srvhttpevt = new httpevent_type(port);
+                auto srvhttpevt = new httpevent_type(port, max_connection, evtdist->is_sharded());
+                admission(srvhttpevt);
+                srvhttpevt->set_zerocopy(zerocopy_min_size);
                 srvhttpevt->init(*evtdist);
                 srvhttpevts.emplace_back(srvhttpevt);
 
@@ -219,7 +358,11 @@ private:
                 auto srvhttpevt_ssl = new httpevent_ssl_type(
                     port,
                     cert_file.c_str(),
-                    prikey_file.c_str());
+                    prikey_file.c_str(),
+                    max_connection,
+                    evtdist->is_sharded());
+                admission(srvhttpevt_ssl);
+                srvhttpevt_ssl->set_ktls(ktls);
                 srvhttpevt_ssl->init(*evtdist);
                 srvhttpevts_ssl.emplace_back(srvhttpevt_ssl);
 
@@ -262,9 +405,24 @@ private:
 
 };
 
-std::function<void()> destroy_app;
 std::function<bool()> IsTerminated;
 
+// Signal handler only writes to it, main thread drains and terminates
+// once woken as drain takes locks and allocates
+int shutdown_fd { -1 };
+
+void request_shutdown() {
+    const auto saved_errno = errno;
+    const uint64_t value { 1 };
+    [[maybe_unused]] auto ret = write(shutdown_fd, &value, sizeof(value));
+    errno = saved_errno;
+}
+
+void wait_shutdown() {
+    uint64_t value;
+    while(read(shutdown_fd, &value, sizeof(value)) < 0 && errno == EINTR);
+}
+
 class mqd_t_raii {
     mqd_t mq;
 public:
@@ -324,7 +482,7 @@ void configuration_thread_function(std::stop_token stoken) {
         
         case rohit::config_t::CONFIG_TERMINATE:
             rohit::log<rohit::log_t::CONFIG_SERVER_TERMINATE>();
-            destroy_app();
+            request_shutdown();
             return;
         default:
             break;
@@ -338,80 +496,8 @@ void segv_app() {
     rohit::segv_log_flush();
 }
 
-int get_receive_buffer_size(const int fd) {
-    int receive_size;
-    unsigned int receive_size_size = sizeof(receive_size);
-    if (getsockopt(fd, SOL_SOCKET, SO_RCVBUF, (void *)&receive_size, &receive_size_size) == -1) {
-        throw rohit::exception_t(rohit::err_t::SOCKET_GET_READ_BUFFER_FAILED);
-    }
-    return receive_size;
-}
-
-void set_receive_buffer_size(const int fd, const size_t buffer_size) {
-    int send_size = buffer_size;
-    unsigned int send_size_size = sizeof(send_size);
-    if (setsockopt(fd, SOL_SOCKET, SO_RCVBUF, (void *)&send_size, send_size_size) == -1) {
-        throw rohit::exception_t(rohit::err_t::SOCKET_SET_READ_BUFFER_FAILED);
-    }
-}
-
-int get_send_buffer_size(const int fd) {
-    int receive_size;
-    unsigned int receive_size_size = sizeof(receive_size);
-    if (getsockopt(fd, SOL_SOCKET, SO_SNDBUF, (void *)&receive_size, &receive_size_size) == -1) {
-        throw rohit::exception_t(rohit::err_t::SOCKET_GET_WRITE_BUFFER_FAILED);
-    }
-    return receive_size;
-}
-
-void set_send_buffer_size(const int fd, const size_t buffer_size) {
-    int send_size = buffer_size;
-    unsigned int send_size_size = sizeof(send_size);
-    if (setsockopt(fd, SOL_SOCKET, SO_SNDBUF, (void *)&send_size, send_size_size) == -1) {
-        throw rohit::exception_t(rohit::err_t::SOCKET_SET_WRITE_BUFFER_FAILED);
-    }
-}
-
-rohit::err_t check_socket_limits() {
-    int temp_fd = socket(AF_INET6, SOCK_STREAM, IPPROTO_TCP);
-
-    auto original_receive_size = get_receive_buffer_size(temp_fd);
-    if (original_receive_size < rohit::config::socket_read_buffer_size) {
-        std::cout << "Socket read buffer is " << original_receive_size << " it must be set to " << rohit::config::socket_read_buffer_size << std::endl;
-        std::cout << "---- Attempting to set socket read limits" << std::endl;
-
-        set_receive_buffer_size(temp_fd, rohit::config::socket_read_buffer_size);
-        auto new_receive_size = get_receive_buffer_size(temp_fd);
-        std::cout << "Socket read buffer set to " << new_receive_size << std::endl;
-        if (new_receive_size < rohit::config::socket_read_buffer_size) {
-            std::cout << "Unable to set receive memory buffer existing" << std::endl;
-            std::cout << "Set setting using `sudo sysctl net.core.rmem_max=" << rohit::config::socket_read_buffer_size <<"`" << std::endl;
-            return rohit::err_t::SOCKET_SET_READ_BUFFER_FAILED;
-        }
-    }
-
-    auto original_send_size = get_send_buffer_size(temp_fd);
-    if (original_send_size < rohit::config::socket_write_buffer_size) {
-        std::cout << "Socket write buffer is "  << original_send_size << " it must be set to " << rohit::config::socket_write_buffer_size << std::endl;
-        std::cout << "---- Attempting to set socket write limits" << std::endl;
-
-        set_send_buffer_size(temp_fd, rohit::config::socket_write_buffer_size);
-        auto new_send_size = get_send_buffer_size(temp_fd);
-        std::cout << "Socket write buffer set to " << new_send_size << std::endl;
-        if (new_send_size < rohit::config::socket_write_buffer_size) {
-            std::cout << "Unable to set write memory buffer existing" << std::endl;
-            std::cout << "Set setting using `sudo sysctl net.core.wmem_max=" << rohit::config::socket_write_buffer_size <<"`" << std::endl;
-            return rohit::err_t::SOCKET_SET_WRITE_BUFFER_FAILED;
-        }
-    }
-
-    return rohit::err_t::SUCCESS;
-}
-
-void signal_destroy_app(int, siginfo_t *, void *) {
-    destroy_app();
-
-    exit(0);
+void signal_request_shutdown(int, siginfo_t *, void *) {
+    request_shutdown();
 }
 
 void signal_segmentation_fault(int, siginfo_t *, void *) {
@@ -424,7 +510,7 @@ void signal_segmentation_fault(int, siginfo_t *, void *) {
 void set_sigaction() {
     struct sigaction sa = { };
     sigemptyset(&sa.sa_mask);
-    sa.sa_sigaction = signal_destroy_app;
+    sa.sa_sigaction = signal_request_shutdown;
     sa.sa_flags   = SA_SIGINFO;
 
     sigaction(SIGINT, &sa, nullptr);
@@ -444,10 +530,11 @@ int main(int argc, char *argv[]) {
         DeviceServerParameter parameter{argc, argv};
         if (!parameter.IsValid() || parameter.GetIsDisplayVersion()) return EXIT_SUCCESS;
 
-        if (isFailure(check_socket_limits())) {
-            return EXIT_SUCCESS;
+        shutdown_fd = eventfd(0, EFD_CLOEXEC);
+        if (shutdown_fd < 0) {
+            std::cout << "Unable to create shutdown eventfd" << std::endl;
+            return EXIT_FAILURE;
         }
-
         set_sigaction();
 
         if (parameter.GetIsLogDebugMode()) {
@@ -459,9 +546,6 @@ int main(int argc, char *argv[]) {
         rohit::init_iot(parameter.GetLogFile());
 
         DeviceServer deviceServer{ parameter };
-        destroy_app = [&deviceServer]() {
-            deviceServer.destroy_app();
-        };
         IsTerminated = [&deviceServer]() {
             return deviceServer.IsTerminated();
         };
@@ -471,9 +555,14 @@ int main(int argc, char *argv[]) {
         // Wait and terminate
         std::cout << "Waiting for all thread to join" << std::endl;
         rohit::log<rohit::log_t::APPLICATION_STARTED_SUCCESSFULLY>();
+        wait_shutdown();
+        deviceServer.destroy_app();
         deviceServer.Wait();
         conf_thread.request_stop();
 
+        // Configuration thread is blocked on its queue after a signal
+        conf_thread.detach();
+
         return 0;
     } catch (rohit::exception_t e) {
         segv_app();
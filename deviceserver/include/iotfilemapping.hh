@@ -15,10 +15,12 @@
 #pragma once
 
 #include <iot/core/error.hh>
+#include <iot/core/io_buffer.hh>
 #include <iot/core/memory_helper.hh>
 #include <iot/core/math.hh>
 #include <time.h>
 #include <sys/stat.h>
+#include <unistd.h>
 #include <string>
 #include <memory>
 #include <unordered_map>
@@ -26,27 +28,29 @@
 namespace rohit::http {
 
 struct file_info {
-    mem_new<const char> content;
+    // Body is shared by write queue of every response sending it
+    io_buffer *const body;
+    const mem<const char> content;
     mem_new<const char> content_type; //Content-Type
     const char *etags;
     static constexpr size_t etags_size = to_string64_hash<uint64_t>();
 
-    inline file_info(
-                mem_new<const char> content,
-                mem_new<const char> content_type,
-                const char *etags)
-        : content(content), content_type(content_type), etags(etags) { }
+    // Sealed in-memory copy of content for sendfile, -1 when body is copied
+    // Snapshot is used so that body always matches etag and Content-Length
+    int fd { -1 };
 
     inline file_info(
-                const char *content,
+                io_buffer *body,
                 size_t content_size,
                 const char *content_type,
                 size_t content_type_size,
                 const char *etags)
-        : content(content, content_size), content_type(content_type, content_type_size), etags(etags) { }
+        : body(body), content((const char *)body->data(), content_size), content_type(content_type, content_type_size), etags(etags) { }
 
     inline ~file_info() {
+        body->release();
         delete[] etags;
+        if (fd >= 0) close(fd);
     }
 };
 
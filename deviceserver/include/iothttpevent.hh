@@ -61,21 +61,43 @@ protected:
     using serverpeerevent<use_ssl>::write_queue;
 
     using serverpeerevent_base::push_write;
+    using serverpeerevent_base::push_write_file;
     using serverpeerevent_base::pop_write;
     using serverpeerevent_base::get_write_buffer;
     using serverpeerevent_base::is_write_left;
+    using serverpeerevent_base::receive_buffer;
+    using serverpeerevent<use_ssl>::receive;
+    using serverpeerevent<use_ssl>::can_read;
+
+    // Body of last request not yet read, it is discarded as it arrives
+    size_t body_left { 0 };
 
     friend class iothttpsslevent;
 
+    // Answers request whose header is first header_size bytes of
+    // receive_buffer, false once connection is moved to HTTP 2
+    bool process_request_header(const size_t header_size);
+
 public:
     inline iothttpevent(socket_variant_t<use_ssl>::type &peer_id) : serverpeerevent<use_ssl>(peer_id) { }
-    inline iothttpevent(iothttpevent<use_ssl> &&http11event) : serverpeerevent<use_ssl>(std::move(http11event)) { }
+    inline iothttpevent(iothttpevent<use_ssl> &&http11event)
+        : serverpeerevent<use_ssl>(std::move(http11event)), body_left(http11event.body_left) { }
     inline iothttpevent(iothttpsslevent &&sslevent) : serverpeerevent<use_ssl>(std::move(sslevent)) {
         static_assert(use_ssl == true, "Only SSL event allowed, this function is for ALPN");
     }
 
     using serverpeerevent<use_ssl>::write_all;
 
+    // Connection over listener limit gets fixed 503, request is dropped unparsed
+    static void reject(const int fd) {
+        static constexpr char busy[] =
+            "HTTP/1.1 503 Service Unavailable\r\n"
+            "Retry-After: 1\r\n"
+            "Content-Length: 0\r\n"
+            "Connection: close\r\n\r\n";
+        ::send(fd, busy, sizeof(busy) - 1, MSG_DONTWAIT | MSG_NOSIGNAL);
+    }
+
     void read_helper();
 
     void execute() override;
@@ -99,9 +121,13 @@ protected:
     using serverpeerevent_base::pop_write;
     using serverpeerevent_base::get_write_buffer;
     using serverpeerevent_base::is_write_left;
+    using serverpeerevent_base::receive_buffer;
+    using serverpeerevent<use_ssl>::receive;
+    using serverpeerevent<use_ssl>::can_read;
 
     rohit::http::v2::dynamic_table_t dynamic_table;
     rohit::http::v2::settings_store peer_settings;
+    bool goaway_sent { false };
 
     friend class iothttpsslevent;
     friend class iothttpevent<use_ssl>;
@@ -116,15 +142,23 @@ public:
     void process_request(rohit::http::v2::request &request);
 
     template <bool moved>
-    void process_read_buffer(uint8_t *read_buffer, const size_t read_buffer_size);
+    void process_read_buffer(const uint8_t *read_buffer, const size_t read_buffer_size);
 
     void upgrade(http_header_request &header);
 
+    // Complete frames in receive_buffer are processed, partial frame
+    // stays till rest of it is read
+    template <state_t state>
+    void process_stream();
+
     template <state_t state>
     void read_helper();
 
     void execute() override;
 
+    // GOAWAY is sent before pending writes are flushed
+    void drain() override;
+
     using serverpeerevent<use_ssl>::close;
 };
 
@@ -133,16 +167,17 @@ public:
 // read_buffer will  not contain connection_preface
 template <bool use_ssl>
 template <bool first_frame>
-void iothttp2event<use_ssl>::process_read_buffer(uint8_t *read_buffer, const size_t read_buffer_size) {
+void iothttp2event<use_ssl>::process_read_buffer(const uint8_t *read_buffer, const size_t read_buffer_size) {
     // HTTP2 on TLS require ALPN support
     // This function is not valid for TLS
     rohit::http::v2::request request(dynamic_table, peer_settings);
-    uint8_t *const write_buffer = ctx.write_buffer;
+    auto io = io_buffer::alloc(ctx.buffer_size);
+    uint8_t *const write_buffer = io->data();
     uint8_t *pwrite_end = write_buffer;
 
     if constexpr (first_frame) {
         // First frame in read buffer must be settings
-        auto pframe = (rohit::http::v2::frame *)read_buffer;
+        auto pframe = (const rohit::http::v2::frame *)read_buffer;
         if (pframe->get_type() != rohit::http::v2::frame::type_t::SETTINGS) {
             // Initiate GOAWAY
             pwrite_end = rohit::http::v2::goaway::add_frame(
@@ -150,11 +185,7 @@ void iothttp2event<use_ssl>::process_read_buffer(uint8_t *read_buffer, const siz
                                 rohit::http::v2::frame::error_t::PROTOCOL_ERROR,
                                 "SETTINGS expected");
 
-            size_t write_size = pwrite_end - write_buffer;
-            uint8_t *_write_buffer = new uint8_t[write_size];
-            assert(_write_buffer);
-            std::copy(write_buffer, pwrite_end, _write_buffer);
-            push_write(_write_buffer, write_size);
+            push_write(io, pwrite_end - write_buffer);
             write_all();
             close();
             return;
@@ -174,11 +205,9 @@ void iothttp2event<use_ssl>::process_read_buffer(uint8_t *read_buffer, const siz
                         pwrite_end);
 
     if (write_buffer != pwrite_end) {
-        size_t write_size = pwrite_end - write_buffer;
-        uint8_t *_write_buffer = new uint8_t[write_size];
-        assert(_write_buffer);
-        std::copy(write_buffer, pwrite_end, _write_buffer);
-        push_write(_write_buffer, write_size);
+        push_write(io, pwrite_end - write_buffer);
+    } else {
+        io->release();
     }
 
     if (ret != err_t::HTTP2_INITIATE_GOAWAY) {
@@ -191,11 +220,12 @@ void iothttp2event<use_ssl>::process_read_buffer(uint8_t *read_buffer, const siz
 
 template <bool use_ssl>
 void iothttpevent<use_ssl>::read_helper() {
-    constexpr size_t read_buffer_size = thread_context::buffer_size;
-    auto read_buffer = ctx.read_buffer;
-    size_t read_buffer_length { };
+    // Pipelining client that does not read responses is not read either
+    if (!can_read()) return;
+
+    size_t read_length { };
 
-    auto err = peer_id.read(read_buffer, read_buffer_size, read_buffer_length);
+    auto err = receive(read_length);
 
     if (err == err_t::SOCKET_RETRY) {
         // No state change required
@@ -203,33 +233,97 @@ void iothttpevent<use_ssl>::read_helper() {
     }
     if (isFailure(err)) {
         log<log_t::HTTP_EVENT_SERVER_READ_FAILED>(err);
+        if (err == err_t::SOCKET_READ_BUFFER_FULL) close();
         return;
     }
 
-    if (read_buffer_length == 0) {
+    if (read_length == 0) {
         // No data indication that wait
         return;
     }
 
-    std::string request_string((char *)read_buffer, read_buffer_length);
+    // Pipelined requests are answered in order, partial request stays in
+    // receive_buffer till rest of it is read
+    while (!receive_buffer.empty()) {
+        if (body_left != 0) {
+            const size_t skip_size = std::min(body_left, receive_buffer.size());
+            receive_buffer.consume(skip_size);
+            body_left -= skip_size;
+            continue;
+        }
+
+        const size_t header_size = http_header_size(receive_buffer.data(), receive_buffer.size());
+        if (header_size == 0) {
+            if (receive_buffer.size() < config::http_max_header_size) break;
+
+            // Header too large to be a request, nothing after it can be parsed
+            auto io = io_buffer::alloc(ctx.buffer_size);
+            const auto &local_address = this->get_local_addr();
+            std::time_t now_time = std::time(0);
+            std::tm* now_tm = std::gmtime(&now_time);
+            uint8_t date_str[config::max_date_string_size];
+            size_t date_str_size = strftime((char *)date_str, config::max_date_string_size, "%a, %d %b %Y %H:%M:%S %Z", now_tm) + 1;
+            auto last_write_buffer = http_add_400_Bad_Request(io->data(), local_address, date_str, date_str_size);
+            push_write(io, (size_t)(last_write_buffer - io->data()));
+            write_all();
+            close();
+            return;
+        }
+
+        if (!process_request_header(header_size)) return;
+    }
+
+    write_all();
+
+    // Pipelined requests of one client must not hold loop thread
+    if (!ctx.consume_io_budget(read_length)) {
+        ctx.defer(this);
+        return;
+    }
+
+    // Tail recurssion
+    read_helper();
+}
+
+template <bool use_ssl>
+bool iothttpevent<use_ssl>::process_request_header(const size_t header_size) {
+    std::string request_string((const char *)receive_buffer.data(), header_size);
 
     http11driver driver;
     auto parserret = driver.parse(request_string);
 
+    // Request is taken out of receive_buffer, body is not used by any method
+    // and is skipped. HTTP 2 prior knowledge preface is verified by HTTP 2.
+    const bool prior_knowledge = !use_ssl && parserret == err_t::SUCCESS &&
+                                 driver.header.method == rohit::http_header_request::METHOD::PRI &&
+                                 driver.header.version == http_header::VERSION::VER_2;
+    if (!prior_knowledge) {
+        size_t body_size = 0;
+        auto length_itr = driver.header.fields.find(http_header::FIELD::Content_Length);
+        if (parserret == err_t::SUCCESS && length_itr != driver.header.fields.end()) {
+            body_size = std::strtoull(length_itr->second.c_str(), nullptr, 10);
+        }
+        const size_t request_size = std::min(header_size + body_size, receive_buffer.size());
+        body_left = header_size + body_size - request_size;
+        receive_buffer.consume(request_size);
+    }
+
     // Date is used by all hence it is created here
     std::time_t now_time = std::time(0);   // get time now
     std::tm* now_tm = std::gmtime(&now_time);
     uint8_t date_str[config::max_date_string_size];
     size_t date_str_size = strftime((char *)date_str, config::max_date_string_size, "%a, %d %b %Y %H:%M:%S %Z", now_tm) + 1;
 
-    auto write_buffer = ctx.write_buffer;
+    // Response is built directly in buffer that goes to write queue
+    auto io = io_buffer::alloc(ctx.buffer_size);
+    auto write_buffer = io->data();
 
-    auto local_address = peer_id.get_local_ipv6_addr();
+    const auto &local_address = this->get_local_addr();
     size_t write_size = 0;
     if (parserret != err_t::SUCCESS) {
         auto last_write_buffer = http_add_400_Bad_Request(write_buffer, local_address, date_str, date_str_size);
         write_size = (size_t)(last_write_buffer - write_buffer);
-    } if (driver.header.method == rohit::http_header_request::METHOD::PRI) {
+    } else if (driver.header.method == rohit::http_header_request::METHOD::PRI) {
         if constexpr(use_ssl) {
             // Reply in HTTP 1.1 only
             auto last_write_buffer = http_add_400_Bad_Request(write_buffer, local_address, date_str, date_str_size);
@@ -237,7 +331,7 @@ void iothttpevent<use_ssl>::read_helper() {
         } else {
             if (driver.header.version == http_header::VERSION::VER_2) {                
                 // Move to HTTP 2
-                ctx.remove_event(peer_id);
+                ctx.remove_event(peer_id, this);
 
                 // below will move current structure to std::move
                 iothttp2event<use_ssl> *http2executor = new iothttp2event<use_ssl>(std::move(*this));
@@ -246,23 +340,19 @@ void iothttpevent<use_ssl>::read_helper() {
 
                 // Add http2executor to epoll
                 ctx.add_event(http2executor->peer_id, EPOLLIN | EPOLLOUT, http2executor);
+                ctx.track_event(http2executor);
 
-                // Execute all read and write
-                auto new_read_buffer = read_buffer + rohit::http::v2::connection_preface_size;
-                auto new_read_buffer_length = read_buffer_length - rohit::http::v2::connection_preface_size;
-
-                if (new_read_buffer_length == 0) {
-                    http2executor->client_state = state_t::HTTP2_FIRST_FRAME;
-                } else {
-                    http2executor->template process_read_buffer<true>(new_read_buffer, new_read_buffer_length);
-                }
+                // Preface and frames read so far are in moved receive_buffer
+                io->release();
+                http2executor->client_state = state_t::HTTP2_NEXT_MAGIC;
+                http2executor->template process_stream<state_t::HTTP2_NEXT_MAGIC>();
 
                 // This is important as we may have missed few events
                 http2executor->execute_protector_noenter();
 
                 ctx.delayed_free(this);
                 // No need to exit loop this will be freed anyway
-                return;
+                return false;
             } else {
                 auto last_write_buffer = http_add_505_HTTP_Version_Not_Supported(write_buffer, local_address, date_str, date_str_size);
                 write_size = (size_t)(last_write_buffer - write_buffer);
@@ -279,7 +369,7 @@ void iothttpevent<use_ssl>::read_helper() {
                 // Only version 2 is supported
 
                 // Move to HTTP 2
-                ctx.remove_event(peer_id);
+                ctx.remove_event(peer_id, this);
 
                 // below will move current structure to std::move
                 iothttp2event<use_ssl> *http2executor = new iothttp2event<use_ssl>(std::move(*this));
@@ -287,16 +377,19 @@ void iothttpevent<use_ssl>::read_helper() {
                 http2executor->enter_loop();
 
                 // Add http2executor to epoll
-                ctx.add_event(http2executor->peer_id, EPOLLIN | EPOLLOUT, http2executor);   
+                ctx.add_event(http2executor->peer_id, EPOLLIN | EPOLLOUT, http2executor);
+                ctx.track_event(http2executor);
 
-                // Execute all read and write
+                // Execute all read and write, preface may already be read
+                io->release();
                 http2executor->upgrade(driver.header);
+                http2executor->template process_stream<state_t::HTTP2_NEXT_MAGIC>();
 
                 // This is important as we may have missed few events
                 http2executor->execute_protector_noenter();
 
                 ctx.delayed_free(this);
-                return;
+                return false;
             }
         }
         
@@ -345,20 +438,24 @@ void iothttpevent<use_ssl>::read_helper() {
 
                     last_write_buffer = copy_http_response_content_length(last_write_buffer, file_details->content.size);
 
-                    const auto write_size_header = (size_t)(last_write_buffer - write_buffer);
-
-                    auto _write_buffer = new uint8_t[write_size_header + 2 + file_details->content.size];
-                    assert(_write_buffer);
-                    last_write_buffer = std::copy(write_buffer, write_buffer + write_size_header, _write_buffer);
                     *last_write_buffer++ = '\r';
                     *last_write_buffer++ = '\n';
-                    last_write_buffer = std::copy(
-                                            file_details->content.begin(),
-                                            file_details->content.end(),
-                                            last_write_buffer);
+                    write_size = (size_t)(last_write_buffer - write_buffer);
 
-                    const auto write_size_full = (size_t)(last_write_buffer - _write_buffer);
-                    push_write(_write_buffer, write_size_full);
+                    // Header is pushed first, body is never copied
+                    push_write(io, write_size);
+                    write_size = 0;
+                    io = nullptr;
+                    if (file_details->fd >= 0 && peer_id.can_sendfile()) {
+                        // From page cache by kernel
+                        push_write_file(file_details->fd, file_details->content.size, file_details);
+                    } else if (file_details->content.size != 0) {
+                        // Cached body is shared by every response sending it
+                        push_write(
+                            file_details->body->share(),
+                            (const uint8_t *)file_details->content.ptr,
+                            file_details->content.size);
+                    }
                 }
             }
         }
@@ -369,15 +466,11 @@ void iothttpevent<use_ssl>::read_helper() {
     }
 
     if (write_size != 0) {
-        auto _write_buffer = new uint8_t[write_size];
-        assert(_write_buffer);
-        std::copy(write_buffer, write_buffer + write_size, _write_buffer);
-        push_write(_write_buffer, write_size);
+        push_write(io, write_size);
+    } else if (io) {
+        io->release();
     }
-    write_all();
-
-    // Tail recurssion
-    read_helper();
+    return true;
 }
 
 template <bool use_ssl>
@@ -433,7 +526,8 @@ void iothttp2event<use_ssl>::upgrade(http_header_request &header) {
     std::string setting = header.fields.at(http_header::FIELD::HTTP2_Settings);    
     peer_settings.parse_base64_frame((uint8_t *)setting.c_str(), setting.size());
 
-    auto write_buffer = ctx.write_buffer;
+    auto io = io_buffer::alloc(ctx.buffer_size);
+    auto write_buffer = io->data();
     auto pwrite_end = write_buffer;
 
     // Adding upgrade packet
@@ -461,11 +555,7 @@ void iothttp2event<use_ssl>::upgrade(http_header_request &header) {
                         rohit::http::v2::settings::identifier_t::SETTINGS_HEADER_TABLE_SIZE, 2048);
 
     pwrite_end = rohit::http::v2::settings::add_ack_frame(pwrite_end);
-    size_t write_size = pwrite_end - write_buffer;
-    uint8_t *_write_buffer = new uint8_t[write_size];
-    assert(_write_buffer);
-    std::copy(write_buffer, pwrite_end, _write_buffer);
-    push_write(_write_buffer, write_size);
+    push_write(io, pwrite_end - write_buffer);
 
     rohit::http::v2::request request(dynamic_table, peer_settings, std::move(header));
     process_request(request);
@@ -483,13 +573,20 @@ void iothttp2event<use_ssl>::process_request(rohit::http::v2::request &request)
     uint8_t date_str[config::max_date_string_size];
     size_t date_str_size = strftime((char *)date_str, config::max_date_string_size, "%a, %d %b %Y %H:%M:%S %Z", now_tm) + 1;
 
-    auto local_address = peer_id.get_local_ipv6_addr();
+    const auto &local_address = this->get_local_addr();
 
-    uint8_t *const write_buffer = ctx.write_buffer;
-    uint8_t *pwrite_end = write_buffer;
+    // Frames of one stream are built in their own buffer
+    io_buffer *io = nullptr;
+    uint8_t *write_buffer = nullptr;
+    uint8_t *pwrite_end = nullptr;
 
     auto *pheader = request.get_first_header();
     while(pheader) {
+        if (io == nullptr) {
+            io = io_buffer::alloc(ctx.buffer_size);
+            write_buffer = pwrite_end = io->data();
+        }
+
         switch(pheader->method) {
         case rohit::http_header_request::METHOD::GET: {
             auto port = local_address.port;
@@ -530,58 +627,36 @@ void iothttp2event<use_ssl>::process_request(rohit::http::v2::request &request)
                             rohit::http::v2::frame::flags_t::END_HEADERS,
                             pheader->stream_identifier);
 
-                    if (write_buffer != pwrite_end) {
-                        size_t write_size = pwrite_end - write_buffer;
-                        uint8_t *_write_buffer = new uint8_t[write_size];
-                        assert(_write_buffer);
-                        std::copy(write_buffer, pwrite_end, _write_buffer);
-                        push_write(_write_buffer, write_size);
-                        pwrite_end = write_buffer;
-                    }
+                    push_write(io, pwrite_end - write_buffer);
+                    io = nullptr;
 
+                    // DATA frame headers share one buffer, payload is
+                    // taken from cached body without copy
                     const uint8_t *data_ptr = (uint8_t *)file_details->content.ptr;
                     size_t data_size = file_details->content.size;
-                    const size_t frame_size = ctx.buffer_size; // 16 KB
-                    size_t write_size;
-                    uint8_t *_write_buffer;
-                    while(data_size + sizeof(rohit::http::v2::frame) > frame_size) {
-                        pframe = (rohit::http::v2::frame *)pwrite_end;
-                        pwrite_end += sizeof(rohit::http::v2::frame);
-                        const size_t current_size = frame_size - sizeof(rohit::http::v2::frame);
+                    const size_t max_payload = ctx.buffer_size - sizeof(rohit::http::v2::frame); // 16 KB frame
+                    const size_t frame_count = data_size == 0 ? 1 : (data_size + max_payload - 1) / max_payload;
+                    auto frame_io = io_buffer::alloc(frame_count * sizeof(rohit::http::v2::frame));
+                    auto pframe_header = frame_io->data();
+                    for (size_t frame_index = 0; frame_index < frame_count; ++frame_index) {
+                        const bool last_frame = frame_index + 1 == frame_count;
+                        const size_t current_size = last_frame ? data_size : max_payload;
+                        pframe = (rohit::http::v2::frame *)pframe_header;
                         pframe->init_frame(
                                 current_size,
                                 rohit::http::v2::frame::type_t::DATA,
-                                rohit::http::v2::frame::flags_t::NONE,
+                                last_frame ? rohit::http::v2::frame::flags_t::END_STREAM : rohit::http::v2::frame::flags_t::NONE,
                                 pheader->stream_identifier);
-                        pwrite_end = std::copy(data_ptr, data_ptr + current_size, pwrite_end);
-
-                        write_size = pwrite_end - write_buffer;
-                        _write_buffer = new uint8_t[write_size];
-                        assert(_write_buffer);
-                        std::copy(write_buffer, pwrite_end, _write_buffer);
-                        push_write(_write_buffer, write_size);
-                        pwrite_end = write_buffer;
+                        push_write(frame_io->share(), pframe_header, sizeof(rohit::http::v2::frame));
+                        if (current_size != 0) {
+                            push_write(file_details->body->share(), data_ptr, current_size);
+                        }
 
+                        pframe_header += sizeof(rohit::http::v2::frame);
                         data_size -= current_size;
                         data_ptr += current_size;
                     }
-
-                    // Data frame
-                    pframe = (rohit::http::v2::frame *)pwrite_end;
-                    pwrite_end += sizeof(rohit::http::v2::frame);
-                    pframe->init_frame(
-                            data_size,
-                            rohit::http::v2::frame::type_t::DATA,
-                            rohit::http::v2::frame::flags_t::END_STREAM,
-                            pheader->stream_identifier);
-                    pwrite_end = std::copy(data_ptr, data_ptr + data_size, pwrite_end);
-
-                    write_size = pwrite_end - write_buffer;
-                    _write_buffer = new uint8_t[write_size];
-                    assert(_write_buffer);
-                    std::copy(write_buffer, pwrite_end, _write_buffer);
-                    push_write(_write_buffer, write_size);
-                    pwrite_end = write_buffer;
+                    frame_io->release();
                 }
             }
             break;
@@ -591,27 +666,60 @@ void iothttp2event<use_ssl>::process_request(rohit::http::v2::request &request)
             break;
         }
 
-        if (write_buffer != pwrite_end) {
-            size_t write_size = pwrite_end - write_buffer;
-            uint8_t *_write_buffer = new uint8_t[write_size];
-            assert(_write_buffer);
-            std::copy(write_buffer, pwrite_end, _write_buffer);
-            push_write(_write_buffer, write_size);
-            pwrite_end = write_buffer;
+        if (io != nullptr && write_buffer != pwrite_end) {
+            push_write(io, pwrite_end - write_buffer);
+            io = nullptr;
         }
 
         pheader = pheader->get_next();
     }
+
+    if (io != nullptr) io->release();
+}
+
+template <bool use_ssl>
+template <state_t state>
+void iothttp2event<use_ssl>::process_stream() {
+    if constexpr (state == state_t::HTTP2_NEXT_MAGIC) {
+        if (receive_buffer.size() < rohit::http::v2::connection_preface_size) {
+            // Rest of preface is in next read
+            return;
+        }
+
+        if (strncmp((const char *)receive_buffer.data(), rohit::http::v2::connection_preface, rohit::http::v2::connection_preface_size))
+        {
+            // This is bad request
+            close();
+            return;
+        }
+
+        receive_buffer.consume(rohit::http::v2::connection_preface_size);
+        client_state = state_t::HTTP2_FIRST_FRAME;
+        process_stream<state_t::HTTP2_FIRST_FRAME>();
+    } else {
+        const size_t frame_length = rohit::http::v2::complete_frame_length(receive_buffer.data(), receive_buffer.size());
+        if (frame_length == 0) {
+            // No complete frame yet
+            return;
+        }
+
+        if constexpr (state == state_t::HTTP2_FIRST_FRAME) {
+            client_state = state_t::SOCKET_PEER_EVENT;
+        }
+        process_read_buffer<state == state_t::HTTP2_FIRST_FRAME>(receive_buffer.data(), frame_length);
+        receive_buffer.consume(frame_length);
+    }
 }
 
 template <bool use_ssl>
 template <state_t state>
 void iothttp2event<use_ssl>::read_helper() {
-    const size_t read_buffer_size = ctx.buffer_size;
-    uint8_t  *read_buffer = ctx.read_buffer;
-    size_t read_buffer_length { };
+    // Streams are not read while responses of earlier ones are queued
+    if (!can_read()) return;
+
+    size_t read_length { };
 
-    auto err = peer_id.read(read_buffer, read_buffer_size, read_buffer_length);
+    auto err = receive(read_length);
 
     if (err == err_t::SOCKET_RETRY) {
         // No state change required
@@ -619,40 +727,66 @@ void iothttp2event<use_ssl>::read_helper() {
     }
     if (isFailure(err)) {
         log<log_t::HTTP2_EVENT_SERVER_READ_FAILED>(static_cast<int>(peer_id), err);
+        // Frame larger than read limit can never complete
+        if (err == err_t::SOCKET_READ_BUFFER_FULL) close();
         return;
     }
 
-    if (read_buffer_length == 0) {
+    if (read_length == 0) {
         // No data indication that wait
         return;
     }
 
-    if constexpr (state == state_t::HTTP2_NEXT_MAGIC) {
-        std::string str_data((char *)read_buffer, rohit::http::v2::connection_preface_size);
+    process_stream<state>();
 
-        if (read_buffer_length < rohit::http::v2::connection_preface_size ||
-            strncmp((char *)read_buffer, rohit::http::v2::connection_preface, rohit::http::v2::connection_preface_size))
-        {
-            // This is bad request
-            close();
+    if constexpr (use_ssl) {
+        if (peer_id.is_closed()) return;
+        if (!ctx.consume_io_budget(read_length)) {
+            ctx.defer(this);
             return;
         }
-        
-        auto new_read_buffer = read_buffer + rohit::http::v2::connection_preface_size;
-        auto new_read_buffer_length = read_buffer_length - rohit::http::v2::connection_preface_size;
 
-        if (new_read_buffer_length == 0) {
-            client_state = state_t::HTTP2_FIRST_FRAME;
-            return;
-        } else {
-            client_state = state_t::SOCKET_PEER_EVENT;
-            process_read_buffer<true>(new_read_buffer, new_read_buffer_length);
+        // Preface or first frame may still be partial
+        switch (client_state) {
+            case state_t::HTTP2_NEXT_MAGIC:
+                read_helper<state_t::HTTP2_NEXT_MAGIC>();
+                break;
+            case state_t::HTTP2_FIRST_FRAME:
+                read_helper<state_t::HTTP2_FIRST_FRAME>();
+                break;
+            default:
+                read_helper<state_t::SOCKET_PEER_READ>();
+                break;
         }
-    } else {
-        process_read_buffer<state == state_t::HTTP2_FIRST_FRAME>(read_buffer, read_buffer_length);
+    }
+}
+
+template <bool use_ssl>
+void iothttp2event<use_ssl>::drain() {
+    switch (client_state) {
+        case state_t::SOCKET_PEER_CLOSE:
+        case state_t::SOCKET_PEER_CLOSED:
+            return;
+        default:
+            break;
+    }
+
+    // Sent only once, drain is called again till write completes
+    if (!goaway_sent) {
+        goaway_sent = true;
+
+        // Every request read so far is already processed
+        auto io = io_buffer::alloc(ctx.buffer_size);
+        uint8_t *const write_buffer = io->data();
+        uint8_t *const pwrite_end = rohit::http::v2::goaway::add_frame(
+                                        write_buffer, rohit::http::v2::goaway::max_stream_id,
+                                        rohit::http::v2::frame::error_t::NO_ERROR,
+                                        "Server shutdown");
+
+        push_write(io, pwrite_end - write_buffer);
     }
 
-    if constexpr (use_ssl) if (!peer_id.is_closed()) read_helper<state_t::SOCKET_PEER_READ>();
+    serverpeerevent<use_ssl>::drain();
 }
 
 template <bool use_ssl>
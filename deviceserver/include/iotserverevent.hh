@@ -16,6 +16,7 @@
 
 #include <iot/net/serverevent.hh>
 #include <iot/message.hh>
+#include <random>
 
 namespace rohit {
 
@@ -35,11 +36,18 @@ private:
     using serverpeerevent<use_ssl>::exit_loop;
     using serverpeerevent<use_ssl>::client_state;
     using serverpeerevent<use_ssl>::write_queue;
+    using serverpeerevent<use_ssl>::refresh_idle_timer;
+    using serverpeerevent<use_ssl>::receive;
+    using serverpeerevent<use_ssl>::can_read;
 
     using serverpeerevent_base::push_write;
+    using serverpeerevent_base::push_write_static;
     using serverpeerevent_base::pop_write;
     using serverpeerevent_base::get_write_buffer;
     using serverpeerevent_base::is_write_left;
+    using serverpeerevent_base::receive_buffer;
+
+    bool disconnect_sent { false };
 
 public:
     using serverpeerevent<use_ssl>::serverpeerevent;
@@ -50,6 +58,22 @@ public:
 
     void execute() override;
 
+    // Device is told to reconnect later before connection is closed
+    void drain() override;
+
+    // Devices turned away together must not come back together, fd and
+    // peer id are reused by next connection so delay is random
+    static uint32_t reconnect_delay_in_ms() {
+        thread_local std::minstd_rand generator { std::random_device { }() };
+        return std::uniform_int_distribution<uint32_t> { 0, config::device_reconnect_spread_in_ms - 1 }(generator);
+    }
+
+    // Connection over listener limit, device is told to come back later
+    static void reject(const int fd) {
+        const message::Disconnect busy { message::DisconnectReason::SERVER_BUSY, reconnect_delay_in_ms() };
+        ::send(fd, &busy, sizeof(busy), MSG_DONTWAIT | MSG_NOSIGNAL);
+    }
+
     using serverpeerevent<use_ssl>::close;
 };
 
@@ -85,11 +109,12 @@ inline void read_keep_alive(write_function writeFunction)
 
 template <bool use_ssl>
 void iotserverevent<use_ssl>::read_helper() {
-    size_t read_buffer_size = 1024;
-    uint8_t read_buffer[read_buffer_size];
-    size_t read_buffer_length { };
+    // Device not reading its responses is not read either
+    if (!can_read()) return;
 
-    auto err = peer_id.read(read_buffer, read_buffer_size, read_buffer_length);
+    size_t read_length { };
+
+    auto err = receive(read_length);
 
     if (err == err_t::SOCKET_RETRY) {
         // No state change required
@@ -100,16 +125,13 @@ void iotserverevent<use_ssl>::read_helper() {
         return;
     }
 
-    if (read_buffer_length == 0) {
+    if (read_length == 0) {
         // No data indication that wait
         return;
     }
 
-    auto base = reinterpret_cast<const rohit::message::Base *>(read_buffer);
-
-    if constexpr (config::debug) {
-        std::cout << "------Request Start---------\n" << *base << "\n------Request End---------\n";
-    }
+    // Device is alive, any message including KEEP_ALIVE extends the deadline
+    refresh_idle_timer(config::device_idle_timeout_in_ms);
 
     auto writeFunction = [this](const std::uint8_t *write_buffer, size_t size)
     {
@@ -117,42 +139,101 @@ void iotserverevent<use_ssl>::read_helper() {
             auto write_base = reinterpret_cast<const rohit::message::Base *>(write_buffer);
             std::cout << "------Response Start---------\n" << *write_base << "\n------Response End---------\n";
         }
-        this->push_write(write_buffer, size);
+        // Responses are static messages
+        this->push_write_static(write_buffer, size);
     };
 
-    switch(base->getMessageCode())
-    {
-        case message::Code::COMMAND:
-            read_command(reinterpret_cast<const message::Command *>(base), writeFunction);
-            break;
+    // Every complete message is answered in order, partial message stays
+    // in receive_buffer till rest of it is read
+    bool stream_valid = true;
+    while (stream_valid) {
+        const size_t message_length = message::frame_length(receive_buffer.data(), receive_buffer.size());
+        if (message_length == 0 || message_length > receive_buffer.size()) break;
 
-        case message::Code::CONNECT:
-            read_connect(base, writeFunction);
-            break;
-            
-        case message::Code::REGISTER:
-            read_register(base, writeFunction);
-            break;
+        auto base = reinterpret_cast<const rohit::message::Base *>(receive_buffer.data());
 
-        case message::Code::KEEP_ALIVE:
-            read_keep_alive(writeFunction);
-            break;
+        if constexpr (config::debug) {
+            std::cout << "------Request Start---------\n" << *base << "\n------Request End---------\n";
+        }
 
-        default:
-            write_bad_request(writeFunction);
-            break;
+        switch(base->getMessageCode())
+        {
+            case message::Code::COMMAND: {
+                auto command = reinterpret_cast<const message::Command *>(base);
+                // Next message can not be found after invalid count
+                stream_valid = command->verify();
+                read_command(command, writeFunction);
+                break;
+            }
+
+            case message::Code::CONNECT:
+                read_connect(base, writeFunction);
+                break;
+                
+            case message::Code::REGISTER:
+                read_register(base, writeFunction);
+                break;
+
+            case message::Code::KEEP_ALIVE:
+                read_keep_alive(writeFunction);
+                break;
+
+            default:
+                write_bad_request(writeFunction);
+                break;
+        }
+
+        receive_buffer.consume(message_length);
     }
 
     write_all();
 
+    if (!stream_valid) {
+        close();
+        return;
+    }
+
+    // Device flooding commands must not hold loop thread
+    if (!ctx.consume_io_budget(read_length)) {
+        ctx.defer(this);
+        return;
+    }
+
     // Tail recurssion
     read_helper();
 }
 
+template <bool use_ssl>
+void iotserverevent<use_ssl>::drain() {
+    switch (client_state) {
+        case state_t::SOCKET_PEER_READ:
+        case state_t::SOCKET_PEER_EVENT:
+        case state_t::SOCKET_PEER_WRITE: {
+            // Sent only once, drain is called again till write completes
+            if (!disconnect_sent) {
+                disconnect_sent = true;
+
+                // Reconnect of all the devices of this server is spread over a window
+                const message::Disconnect disconnect { message::DisconnectReason::SERVER_SHUTDOWN, reconnect_delay_in_ms() };
+                auto io = io_buffer::alloc(sizeof(disconnect));
+                std::copy((const uint8_t *)&disconnect, (const uint8_t *)&disconnect + sizeof(disconnect), io->data());
+                push_write(io, sizeof(disconnect));
+            }
+            break;
+        }
+        default:
+            break;
+    }
+
+    serverpeerevent<use_ssl>::drain();
+}
+
 template <bool use_ssl>
 void iotserverevent<use_ssl>::execute() {
     switch (client_state) {
         case state_t::SOCKET_PEER_ACCEPT: {
+            // Handshake that never completes is also timed out
+            refresh_idle_timer(config::device_idle_timeout_in_ms);
             auto err = peer_id.accept();
             if (err == err_t::SUCCESS) {
                 client_state = state_t::SOCKET_PEER_EVENT;
@@ -165,8 +246,14 @@ void iotserverevent<use_ssl>::execute() {
             close();
             break;
         }
-        case state_t::SOCKET_PEER_EVENT:
         case state_t::SOCKET_PEER_READ: {
+            // First event of connection, half-open connection is also timed out
+            refresh_idle_timer(config::device_idle_timeout_in_ms);
+            client_state = state_t::SOCKET_PEER_EVENT;
+            read_helper();
+            break;
+        }
+        case state_t::SOCKET_PEER_EVENT: {
             read_helper();
             break;
         }
@@ -16,6 +16,8 @@
 #include <iot/core/error.hh>
 #include <iotfilemapping.hh>
 #include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <unistd.h>
 
 namespace rohit::http {
@@ -36,6 +38,29 @@ inline uint64_t get_etags(int fd) {
     return nanos;
 }
 
+// Page cache backed copy of content, sealed so it can never change
+inline int create_sendfile_fd(const std::string &relativepath, const char *buffer, size_t size) {
+    int fd = memfd_create(relativepath.c_str(), MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd == -1) {
+        log<log_t::WEB_SERVER_SENDFILE_FD_FAILED>(errno);
+        return -1;
+    }
+
+    size_t written = 0;
+    while (written < size) {
+        auto ret = write(fd, buffer + written, size - written);
+        if (ret <= 0) {
+            log<log_t::WEB_SERVER_SENDFILE_FD_FAILED>(errno);
+            close(fd);
+            return -1;
+        }
+        written += ret;
+    }
+
+    fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+    return fd;
+}
+
 void filemap::add_file(const std::string &relativepath) {
     size_t period_pos = relativepath.rfind('.');
     if (period_pos == std::string::npos) {
@@ -64,7 +89,8 @@ void filemap::add_file(const std::string &relativepath) {
     fstat(fd, &bufstat);
 
     int size = bufstat.st_size;
-    char *buffer = new char[size];
+    auto body = io_buffer::alloc(size);
+    char *buffer = (char *)body->data();
     [[maybe_unused]] auto read_size = read(fd, buffer, size);
 
     uint64_t etag = get_etags(fd);
@@ -78,9 +104,12 @@ void filemap::add_file(const std::string &relativepath) {
     std::copy(content_type_str.begin(), content_type_str.end(), content_type_buffer);
 
     std::shared_ptr<file_info> file_details = std::make_shared<file_info>(
-        buffer, size,
+        body, size,
         content_type_buffer, content_type_str.length() + 1,
         etag_buffer);
+    if (static_cast<size_t>(size) >= config::http_sendfile_min_size) {
+        file_details->fd = create_sendfile_fd(relativepath, buffer, size);
+    }
     cache.insert(std::make_pair(relativepath, file_details));
 }
 
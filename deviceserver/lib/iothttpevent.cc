@@ -26,7 +26,7 @@ void iothttpsslevent::execute() {
             auto err = peer_id.accept();
             if (err == err_t::SUCCESS) {
                 // First remove from epoll
-                ctx.remove_event(peer_id);
+                ctx.remove_event(peer_id, this);
 
 
                 const uint8_t *data;
@@ -40,6 +40,7 @@ void iothttpsslevent::execute() {
 
                     // Add http2executor to epoll
                     ctx.add_event(http2executor->peer_id, EPOLLIN | EPOLLOUT, http2executor);
+                    ctx.track_event(http2executor);
 
                     http2executor->execute();
 
@@ -52,6 +53,7 @@ void iothttpsslevent::execute() {
 
                     // Add http2executor to epoll
                     ctx.add_event(httpexecutor->peer_id, EPOLLIN | EPOLLOUT, httpexecutor);
+                    ctx.track_event(httpexecutor);
 
                     httpexecutor->execute();
 
@@ -14,6 +14,7 @@
 
 #pragma once
 #include <md5.h>
+#include <algorithm>
 #include <string>
 #include <unordered_map>
 #include <iostream>
@@ -693,6 +694,16 @@ constexpr uint8_t *copy_http_response_content_length(
     return copy_http_header_response(write_buffer, length_line);
 }
 
+// Bytes of request header at start of buffer including empty line that
+// ends it, 0 till whole header is received
+inline size_t http_header_size(const uint8_t *buffer, const size_t size) {
+    constexpr uint8_t header_end[] { '\r', '\n', '\r', '\n' };
+    if (buffer == nullptr) return 0;
+    auto pend = std::search(buffer, buffer + size, header_end, header_end + sizeof(header_end));
+    if (pend == buffer + size) return 0;
+    return (size_t)(pend - buffer) + sizeof(header_end);
+}
+
 template <size_t N>
 constexpr uint8_t *copy_http_response(
             uint8_t *const buffer,
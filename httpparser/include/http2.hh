@@ -233,6 +233,18 @@ inline std::ostream& operator<<(std::ostream& os, const frame &http2frame) {
         << ", F:" << http2frame.get_flags() << ", ID:" << http2frame.get_stream_identifier() << '}';
 }
 
+// Bytes of complete frames at start of buffer, partial frame at end is
+// left for next read
+inline size_t complete_frame_length(const uint8_t *buffer, const size_t size) {
+    size_t length = 0;
+    while (length + sizeof(frame) <= size) {
+        const size_t frame_length = sizeof(frame) + ((const frame *)(buffer + length))->get_length();
+        if (length + frame_length > size) break;
+        length += frame_length;
+    }
+    return length;
+}
+
 struct header {
 private:
     /* Big endian
@@ -423,19 +435,20 @@ private:
     uint32_t        last_stream_id:31;
     uint32_t        error_code; */
 
-    // Little endian
-    uint32_t        last_stream_id:31;
-    uint32_t        reserved:1;
+    // Reserved bit is top bit of first byte, kept with stream id
+    // as bitfield would place it in last byte on little endian
+    uint32_t        last_stream_id;
     uint32_t        error_code;
 
 public:
+    static constexpr uint32_t max_stream_id = 0x7fffffff;
+
     constexpr goaway(
                 const uint32_t &last_stream_id,
                 const frame::error_t &error_code)
-            :   last_stream_id(changeEndian(last_stream_id)),
-                reserved(0),
+            :   last_stream_id(changeEndian(last_stream_id & max_stream_id)),
                 error_code(changeEndian((uint32_t)error_code)) {}
-    constexpr uint32_t get_last_stream_id() const { return changeEndian(last_stream_id);}
+    constexpr uint32_t get_last_stream_id() const { return changeEndian(last_stream_id) & max_stream_id; }
     constexpr frame::error_t get_error_code() const { return (frame::error_t)changeEndian(error_code); }
 
     template <size_t debug_data_size>
@@ -449,14 +462,13 @@ public:
                 uint32_t max_stream,
                 frame::error_t error_code,
                 const char (&debug_data)[debug_data_size]) {
-        const uint32_t length = sizeof(frame) + sizeof(goaway) + debug_data_size;
+        const uint32_t length = sizeof(goaway) + debug_data_size;
         frame *pframe = (frame *)buffer;
         buffer += sizeof(frame);
-        pframe->init_frame(length, frame::type_t::SETTINGS, frame::flags_t::ACK, 0x00);
-        
-        const goaway goaway {max_stream, error_code};
-        buffer = std::copy(buffer, buffer + sizeof(goaway), buffer);
-        buffer += sizeof(goaway);
+        pframe->init_frame(length, frame::type_t::GOAWAY, frame::flags_t::NONE, 0x00);
+
+        const goaway goaway_payload {max_stream, error_code};
+        buffer = std::copy((const uint8_t *)&goaway_payload, (const uint8_t *)&goaway_payload + sizeof(goaway), buffer);
 
         buffer = std::copy(debug_data, debug_data + debug_data_size, buffer);
         return buffer;
@@ -0,0 +1,65 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace rohit {
+
+__extension__ typedef unsigned __int128 clock_uint128_t;
+
+// Resolution is one scheduler tick (1 to 4ms), read never leaves vDSO
+// and does not touch clock source. Good enough for state timestamps.
+inline uint64_t coarse_now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+// Cycle counter for short intervals. Invariant TSC is used when CPU has
+// one, otherwise ticks are CLOCK_MONOTONIC nanoseconds.
+class cycle_clock {
+private:
+    static bool use_tsc;
+
+    // Nanoseconds per tick in 32.32 fixed point
+    static uint64_t ns_per_tick;
+
+public:
+    // Measures TSC frequency, called once by event_distributor::init
+    static void calibrate();
+
+    static inline uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+        if (use_tsc) return __rdtsc();
+#endif
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+    }
+
+    static inline uint64_t to_ns(const uint64_t ticks) {
+        return static_cast<uint64_t>((static_cast<clock_uint128_t>(ticks) * ns_per_tick) >> 32);
+    }
+
+    static inline bool is_tsc() { return use_tsc; }
+}; // class cycle_clock
+
+} // namespace rohit
@@ -0,0 +1,82 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <sched.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+namespace rohit {
+
+enum class thread_placement_t {
+    NONE,       // Scheduler decides
+    COMPACT,    // Fill SMT siblings, then cores, then packages
+    SCATTER,    // Spread over packages, then cores, SMT siblings last
+    LIST,       // Explicit CPU list, one CPU for each thread
+    NUMA_NODE,  // One thread for each NUMA node, free to run on any CPU of node
+};
+
+// Unknown string is NONE
+thread_placement_t to_thread_placement(const std::string &placement);
+
+struct thread_placement {
+    thread_placement_t policy { thread_placement_t::NONE };
+
+    // Used only by LIST
+    std::vector<int> cpu_list { };
+};
+
+struct cpu_info {
+    int cpu;
+    int core;
+    int package;
+    int node;
+};
+
+// CPUs this process is allowed to run on, read from sysfs
+// Missing sysfs entries are treated as single package and single node
+class cpu_topology {
+private:
+    std::vector<cpu_info> cpus;
+    std::vector<int> nodes;
+
+    cpu_topology();
+
+public:
+    static const cpu_topology &get();
+
+    inline const std::vector<cpu_info> &get_cpus() const { return cpus; }
+    inline size_t get_cpu_count() const { return cpus.size(); }
+    inline size_t get_node_count() const { return nodes.size(); }
+
+    // Returns -1 if cpu is not allowed
+    int node_of(const int cpu) const;
+
+    // Thread count for zero thread_count, 0 means number of CPU
+    size_t default_thread_count(const thread_placement &placement) const;
+
+    // CPU set for each thread, empty set means thread is not pinned
+    std::vector<cpu_set_t> placement(const thread_placement &placement, const size_t thread_count) const;
+};
+
+// Node of CPU calling thread is running on
+int current_numa_node();
+
+// Migrates pages covering [addr, addr + size) to node.
+// Used by thread to bring memory touched by creating thread to its own node.
+void move_to_numa_node(const void *addr, const size_t size, const int node);
+
+} // namespace rohit
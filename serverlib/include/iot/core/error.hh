@@ -70,10 +70,13 @@ namespace rohit {
     ERROR_T_ENTRY(SOCKET_CONNECT_TIMEOUT, "Unable to connect as it timeout") \
     ERROR_T_ENTRY(SOCKET_WRITE_ZERO, "Socket write written zero byte") \
     ERROR_T_ENTRY(SOCKET_RETRY, "Socket retry last operation") \
+    ERROR_T_ENTRY(SOCKET_WAIT_TIMEOUT, "Socket was not ready before deadline") \
     ERROR_T_ENTRY(SOCKET_GET_READ_BUFFER_FAILED, "Socket read buffer get failed") \
     ERROR_T_ENTRY(SOCKET_GET_WRITE_BUFFER_FAILED, "Socket write buffer get failed") \
     ERROR_T_ENTRY(SOCKET_SET_READ_BUFFER_FAILED, "Socket read buffer set failed") \
     ERROR_T_ENTRY(SOCKET_SET_WRITE_BUFFER_FAILED, "Socket write buffer set failed") \
+    ERROR_T_ENTRY(SOCKET_READ_BUFFER_FULL, "Unconsumed read data reached connection limit") \
+    ERROR_T_ENTRY(SOCKET_ZEROCOPY_NOBUFS, "Zerocopy send over socket memory limit, data has to be copied") \
     \
     ERROR_T_ENTRY(SOCKET_SSL_CONTEXT_FAILED, "Creation on SSL context failed") \
     ERROR_T_ENTRY(SOCKET_SSL_CERTIFICATE_FAILED, "Failed to load SSL certificate") \
@@ -99,6 +102,8 @@ namespace rohit {
     ERROR_T_ENTRY(MATH_INSUFFICIENT_BUFFER, "Buffer is not sufficient to store result, partial and wrong result may have been written to buffer") \
     \
     ERROR_T_ENTRY(EVENT_DIST_CREATE_FAILED, "Event distributor creation failed") \
+    ERROR_T_ENTRY(TIMER_WHEEL_LIMIT_REACHED, "Timer wheel creation failed, too many wheels alive") \
+    ERROR_T_ENTRY(COMPUTE_POOL_CREATE_FAILED, "Compute pool creation failed") \
     ERROR_T_ENTRY(EVENT_CREATE_FAILED, "Event creation failed") \
     ERROR_T_ENTRY(EVENT_CREATE_FAILED_ZERO, "Event creation failed for 0 file descriptor value") \
     ERROR_T_ENTRY(EVENT_REMOVE_FAILED, "Event remove failed") \
@@ -0,0 +1,119 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <iot/core/config.hh>
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace rohit {
+
+class io_buffer_pool;
+
+// Refcounted buffer for outgoing data. Handler writes into data() and
+// hands its reference to write queue, last release returns buffer to
+// pool of thread that allocated it. Immutable buffer can be shared by
+// many write queues at once, each holding its own reference.
+class alignas(16) io_buffer {
+private:
+    std::atomic<uint32_t> refcount { 1 };
+    const uint32_t size_class;
+    const size_t buffer_capacity;
+    io_buffer_pool *const pool;
+    io_buffer *next { nullptr };
+
+    friend class io_buffer_pool;
+
+    inline io_buffer(const uint32_t size_class, const size_t buffer_capacity, io_buffer_pool *pool)
+        : size_class(size_class), buffer_capacity(buffer_capacity), pool(pool) { }
+
+    void free();
+
+public:
+    io_buffer(const io_buffer &) = delete;
+    io_buffer &operator=(const io_buffer &) = delete;
+
+    // Buffer of at least size bytes with one reference held by caller
+    static io_buffer *alloc(const size_t size);
+
+    inline uint8_t *data() { return reinterpret_cast<uint8_t *>(this + 1); }
+    inline const uint8_t *data() const { return reinterpret_cast<const uint8_t *>(this + 1); }
+    constexpr size_t capacity() const { return buffer_capacity; }
+
+    // Reference for one more owner
+    inline io_buffer *share() {
+        refcount.fetch_add(1, std::memory_order_relaxed);
+        return this;
+    }
+
+    inline void release() {
+        if (refcount.fetch_sub(1, std::memory_order_acq_rel) == 1) free();
+    }
+
+    inline uint32_t use_count() const { return refcount.load(std::memory_order_relaxed); }
+};
+
+// Size classed free lists of one thread. Buffer released on other thread
+// is pushed to remote list and picked up by owner on its next alloc.
+// Pool lives till its thread exits and every buffer from it is released.
+class io_buffer_pool {
+public:
+    static constexpr size_t class_count = 5;
+    static constexpr size_t class_size[class_count] { 256, 1024, 4096, 16384, 65536 };
+
+    // Larger buffers are allocated and freed directly
+    static constexpr uint32_t large_class = class_count;
+
+private:
+    io_buffer *free_list[class_count] { };
+    size_t free_count[class_count] { };
+    std::atomic<io_buffer *> remote_list { nullptr };
+
+    // One for owner thread and one for every buffer not in free list
+    std::atomic<size_t> refcount { 1 };
+
+    uint64_t alloc_count { 0 };
+    uint64_t reuse_count { 0 };
+
+    static thread_local io_buffer_pool *local_pool;
+
+    static io_buffer *create_buffer(const uint32_t size_class, const size_t capacity, io_buffer_pool *pool);
+    static void destroy_buffer(io_buffer *buffer);
+
+    void collect_remote();
+    void destroy_free_list();
+    void unref();
+
+    friend class io_buffer;
+    friend struct io_buffer_pool_holder;
+
+    inline ~io_buffer_pool() { destroy_free_list(); }
+
+public:
+    static io_buffer_pool &local();
+
+    io_buffer *alloc(const size_t size);
+    void free(io_buffer *buffer);
+
+    constexpr uint64_t get_alloc_count() const { return alloc_count; }
+    constexpr uint64_t get_reuse_count() const { return reuse_count; }
+};
+
+inline io_buffer *io_buffer::alloc(const size_t size) {
+    return io_buffer_pool::local().alloc(size);
+}
+
+} // namespace rohit
@@ -0,0 +1,117 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace rohit {
+
+// Log linear buckets, 8 sub buckets for each power of 2 keeps relative
+// error under 12.5%. Values below 8 have exact bucket, values above
+// 2^41 go to last bucket.
+namespace latency_bucket {
+constexpr size_t sub_bucket_bits = 3;
+constexpr size_t sub_bucket_count = 1 << sub_bucket_bits;
+constexpr size_t max_msb = 40;
+constexpr size_t count = (max_msb - 1) * sub_bucket_count;
+constexpr uint64_t max_value = (2ULL << max_msb) - 1;
+
+constexpr size_t index(uint64_t value) {
+    if (value < sub_bucket_count) return static_cast<size_t>(value);
+    if (value > max_value) value = max_value;
+    const size_t msb = 63 - __builtin_clzll(value);
+    return (msb - sub_bucket_bits + 1) * sub_bucket_count + ((value >> (msb - sub_bucket_bits)) & (sub_bucket_count - 1));
+}
+
+// Smallest value that falls in bucket
+constexpr uint64_t lower(const size_t index) {
+    if (index < sub_bucket_count) return index;
+    const size_t exponent = index / sub_bucket_count;
+    const size_t mantissa = index % sub_bucket_count;
+    return static_cast<uint64_t>(sub_bucket_count + mantissa) << (exponent - 1);
+}
+
+static_assert(index(max_value) == count - 1);
+static_assert(lower(index(4096)) == 4096);
+} // namespace latency_bucket
+
+class latency_histogram;
+
+// Plain copy of histogram, can be merged and queried
+struct latency_snapshot {
+    uint64_t counts[latency_bucket::count] { };
+    uint64_t count { 0 };
+    uint64_t total_ns { 0 };
+    uint64_t max_ns { 0 };
+
+    inline void add(const latency_histogram &histogram);
+
+    // Lower bound of bucket holding requested percentile, 0 if empty
+    inline uint64_t percentile(const double percent) const {
+        if (count == 0) return 0;
+        auto rank = static_cast<uint64_t>(static_cast<double>(count) * percent / 100.0);
+        if (rank >= count) rank = count - 1;
+        uint64_t seen = 0;
+        for(size_t index = 0; index < latency_bucket::count; ++index) {
+            seen += counts[index];
+            if (seen > rank) return latency_bucket::lower(index);
+        }
+        return max_ns;
+    }
+
+    inline uint64_t mean() const { return count == 0 ? 0 : total_ns / count; }
+};
+
+// Written only by one thread, readers get relaxed snapshot without
+// stopping writer. Counts read during update can be off by one.
+class latency_histogram {
+private:
+    std::atomic<uint64_t> counts[latency_bucket::count] { };
+    std::atomic<uint64_t> count { 0 };
+    std::atomic<uint64_t> total_ns { 0 };
+    std::atomic<uint64_t> max_ns { 0 };
+
+    friend struct latency_snapshot;
+
+    // Single writer does not need read-modify-write
+    static inline void increment(std::atomic<uint64_t> &value, const uint64_t delta) {
+        value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+
+public:
+    inline void record(const uint64_t value_ns) {
+        increment(counts[latency_bucket::index(value_ns)], 1);
+        increment(count, 1);
+        increment(total_ns, value_ns);
+        if (value_ns > max_ns.load(std::memory_order_relaxed)) max_ns.store(value_ns, std::memory_order_relaxed);
+    }
+
+    inline uint64_t get_count() const { return count.load(std::memory_order_relaxed); }
+};
+
+inline void latency_snapshot::add(const latency_histogram &histogram) {
+    for(size_t index = 0; index < latency_bucket::count; ++index) {
+        const auto value = histogram.counts[index].load(std::memory_order_relaxed);
+        counts[index] += value;
+        count += value;
+    }
+    total_ns += histogram.total_ns.load(std::memory_order_relaxed);
+    const auto value = histogram.max_ns.load(std::memory_order_relaxed);
+    if (value > max_ns) max_ns = value;
+}
+
+} // namespace rohit
@@ -95,6 +95,11 @@ namespace rohit {
     LOGGER_ENTRY(SOCKET_LISTEN_SUCCESS, DEBUG, SOCKET, "Socket %i, port %i listen success") \
     LOGGER_ENTRY(SOCKET_ACCEPT_SUCCESS, DEBUG, SOCKET, "Socket %i accept success, new socket created %i") \
     LOGGER_ENTRY(SOCKET_SET_NONBLOCKING_FAILED, ERROR, SOCKET, "Socket %i setting non blocking failed") \
+    LOGGER_ENTRY(SOCKET_SET_BUSY_POLL_FAILED, WARNING, SOCKET, "Socket %i setting busy poll failed with error %ve, needs CAP_NET_ADMIN above net.core.busy_read") \
+    LOGGER_ENTRY(SOCKET_SET_TCP_PROFILE_FAILED, WARNING, SOCKET, "Socket %i setting TCP profile failed with error %ve, rest of the options are set") \
+    LOGGER_ENTRY(SOCKET_BUFFER_CLAMPED, WARNING, SOCKET, "Socket %i buffer %i clamped to %i, raise net.core.rmem_max or net.core.wmem_max") \
+    LOGGER_ENTRY(SOCKET_ZEROCOPY_UNAVAILABLE, DEBUG, SOCKET, "FD %i: Zerocopy not supported by socket, error %ve, sending copy") \
+    LOGGER_ENTRY(SOCKET_ZEROCOPY_COPIED, DEBUG, SOCKET, "FD %i: Kernel copied zerocopy send, connection sends copy from now") \
     LOGGER_ENTRY(SYSTEM_ERROR, ERROR, SYSTEM, "System Error '%ve'") \
     LOGGER_ENTRY(IOT_ERROR, ERROR, SYSTEM, "IOT Error '%vE'") \
     LOGGER_ENTRY(SETTING_LOG_LEVEL_FAILED, ALERT, SYSTEM, "FAILED: Setting Log level %vl for module %vm") \
@@ -121,6 +126,7 @@ namespace rohit {
     LOGGER_ENTRY(SOCKET_SSL_ACCEPT_RETRY, DEBUG, SOCKET, "FD %i: SSL Socket accept retry SSL Accept") \
     LOGGER_ENTRY(SOCKET_SSL_ACCEPT_SUCCESS, VERBOSE, SOCKET, "FD %i: SSL Socket accept success") \
     LOGGER_ENTRY(SOCKET_SSL_ACCEPT_FAILED, ERROR, SOCKET, "FD %i: SSL Socket accept failed, with %vc") \
+    LOGGER_ENTRY(SOCKET_SSL_KTLS_UNAVAILABLE, WARNING, SOCKET, "FD %i: kTLS requested but OpenSSL is built without it, using userspace TLS") \
     \
     LOGGER_ENTRY(EVENT_DIST_CREATING_THREAD, DEBUG, EVENT_DISTRIBUTOR, "Event distributor creating %llu threads") \
     LOGGER_ENTRY(EVENT_DIST_LOOP_CREATED, DEBUG, EVENT_DISTRIBUTOR, "Event distributor thread loop created") \
@@ -132,12 +138,28 @@ namespace rohit {
     LOGGER_ENTRY(EVENT_DIST_EXIT_THREAD_JOIN_FAILED, WARNING, EVENT_DISTRIBUTOR, "Event distributor unable to join thread with error %ve") \
     LOGGER_ENTRY(EVENT_DIST_EXIT_THREAD_JOIN_SUCCESS, VERBOSE, EVENT_DISTRIBUTOR, "Event distributor join thread success") \
     LOGGER_ENTRY(EVENT_DIST_CREATE_SUCCESS, INFO, EVENT_DISTRIBUTOR, "Event distributor creation succeeded") \
+    LOGGER_ENTRY(EVENT_DIST_CREATE_SHARDED, INFO, EVENT_DISTRIBUTOR, "Event distributor sharded into %llu epoll instances") \
+    LOGGER_ENTRY(EVENT_DIST_THREAD_PLACED, INFO, EVENT_DISTRIBUTOR, "Event distributor thread %llu running on CPU %i, NUMA node %i") \
+    LOGGER_ENTRY(EVENT_DIST_THREAD_PLACEMENT_FAILED, WARNING, EVENT_DISTRIBUTOR, "Event distributor unable to pin thread %llu, error %ve, thread is not pinned") \
+    LOGGER_ENTRY(EVENT_DIST_TASK_QUEUE_CREATE_FAILED, ERROR, EVENT_DISTRIBUTOR, "Event distributor task queue creation failed with error %ve") \
+    LOGGER_ENTRY(EVENT_DIST_TASK_DOORBELL_FAILED, ERROR, EVENT_DISTRIBUTOR, "Event distributor task queue doorbell failed with error %ve") \
     LOGGER_ENTRY(EVENT_DIST_TERMINATING, INFO, EVENT_DISTRIBUTOR, "Event distributor TERMINATING") \
+    LOGGER_ENTRY(EVENT_DIST_TERMINATE_EVENT_FAILED, WARNING, EVENT_DISTRIBUTOR, "Event distributor unable to create terminate event with error %ve, threads exit on next wait timeout") \
+    LOGGER_ENTRY(EVENT_DIST_DRAINING, INFO, EVENT_DISTRIBUTOR, "Event distributor draining %llu executors within %i milliseconds") \
+    LOGGER_ENTRY(EVENT_DIST_DRAINED, INFO, EVENT_DISTRIBUTOR, "Event distributor drained all executors") \
+    LOGGER_ENTRY(EVENT_DIST_DRAIN_TIMEOUT, WARNING, EVENT_DISTRIBUTOR, "Event distributor drain timed out, force closing %llu executors") \
+    LOGGER_ENTRY(EVENT_DIST_DRAIN_FROM_LOOP_THREAD, ERROR, EVENT_DISTRIBUTOR, "Event distributor drain called from loop thread, not draining") \
     LOGGER_ENTRY(EVENT_DIST_EVENT_RECEIVED, DEBUG, EVENT_DISTRIBUTOR, "Event distributor event %vv receive") \
+    LOGGER_ENTRY(EVENT_DIST_BATCH_STATS, DEBUG, EVENT_DISTRIBUTOR, "Event distributor thread %llu, wakeups %llu, events %llu, batch size %llu") \
+    LOGGER_ENTRY(EVENT_DIST_LATENCY_STATS, DEBUG, EVENT_DISTRIBUTOR, "Event distributor thread %llu, dispatched %llu, latency p50 %llu ns, p99 %llu ns, max %llu ns") \
     LOGGER_ENTRY(EVENT_DIST_DEADLOCK_DETECTED, ALERT, EVENT_DISTRIBUTOR, "Event distributor deadlock detected in thread %llu, state %vs") \
     LOGGER_ENTRY(EVENT_DIST_PAUSED_THREAD, DEBUG, EVENT_DISTRIBUTOR, "Event distributor pausing thread %llu") \
     LOGGER_ENTRY(EVENT_DIST_RESUMED_THREAD, DEBUG, EVENT_DISTRIBUTOR, "Event distributor resumed thread %llu") \
     LOGGER_ENTRY(EVENT_DIST_PAUSED_THREAD_FAILED, ERROR, EVENT_DISTRIBUTOR, "Event distributor failed to pause") \
+    LOGGER_ENTRY(COMPUTE_POOL_CREATED, INFO, EVENT_DISTRIBUTOR, "Compute pool created with %llu threads") \
+    LOGGER_ENTRY(COMPUTE_POOL_CREATE_FAILED, ERROR, EVENT_DISTRIBUTOR, "Compute pool failed to create any thread") \
+    LOGGER_ENTRY(COMPUTE_JOB_COMPLETED, DEBUG, EVENT_DISTRIBUTOR, "Compute job of kind %i queued for %llu ns, ran for %llu ns") \
+    LOGGER_ENTRY(COMPUTE_POOL_STATS, INFO, EVENT_DISTRIBUTOR, "Compute pool kind %i, jobs %llu, average queue %llu ns, average run %llu ns, max run %llu ns") \
     \
     LOGGER_ENTRY(EVENT_CREATE_FAILED, ERROR, EVENT_EXECUTOR, "FD %i: Event creation failed with error %ve") \
     LOGGER_ENTRY(EVENT_CREATE_SUCCESS, DEBUG, EVENT_EXECUTOR, "FD %i: Event creation succeeded") \
@@ -148,6 +170,7 @@ namespace rohit {
     LOGGER_ENTRY(EVENT_SERVER_SSL_RECEIVED_EVENT, DEBUG, EVENT_SERVER, "FD %i: SSL Event server received event %vv") \
     LOGGER_ENTRY(EVENT_SERVER_ACCEPT_FAILED, ERROR, EVENT_SERVER, "FD %i: Event server failed to accept connection with error %ve") \
     LOGGER_ENTRY(EVENT_SERVER_SSL_ACCEPT_FAILED, ERROR, EVENT_SERVER, "SSL Event server failed to accept connection with error %ve") \
+    LOGGER_ENTRY(EVENT_SERVER_BUSY_POLL_ENABLED, INFO, EVENT_SERVER, "FD %i: Event server peers spin loop thread %i microseconds before blocking") \
     LOGGER_ENTRY(EVENT_SERVER_PEER_CREATED, VERBOSE, EVENT_SERVER, "FD %i: Event server new peer %i created from remote %vN") \
     LOGGER_ENTRY(EVENT_SERVER_HELPER_WRITE_FAILED, WARNING, EVENT_SERVER, "Event server helper event write failed with error %ve") \
     LOGGER_ENTRY(EVENT_SERVER_HELPER_READ_FAILED, WARNING, EVENT_SERVER, "Event server helper event read failed with error %ve") \
@@ -156,6 +179,15 @@ namespace rohit {
     LOGGER_ENTRY(EVENT_SERVER_SSL_CLOSED_WRITE, INFO, EVENT_SERVER, "FD %i: SSL Event failed to write as socket is closed") \
     LOGGER_ENTRY(EVENT_SERVER_UNKNOWN_STATE, WARNING, EVENT_SERVER, "FD %i: Entered event server for unknown state %vs") \
     LOGGER_ENTRY(EVENT_SERVER_CONNECTION_CLOSED, INFO, IOT_EVENT_SERVER, "FD %i: Event Server connection closed") \
+    LOGGER_ENTRY(EVENT_SERVER_COROUTINE_FAILED, ERROR, EVENT_SERVER, "Peer %i: Connection handler coroutine failed with exception, closing connection") \
+    LOGGER_ENTRY(EVENT_SERVER_IDLE_TIMEOUT, INFO, EVENT_SERVER, "FD %i: Event Server connection idle timeout, closing") \
+    LOGGER_ENTRY(EVENT_SERVER_DRAINING, INFO, EVENT_SERVER, "FD %i: Event server draining, stopped accepting connections") \
+    LOGGER_ENTRY(EVENT_SERVER_CONNECTION_REJECTED, INFO, EVENT_SERVER, "FD %i: Event server rejected peer %i, active connections %i") \
+    LOGGER_ENTRY(EVENT_SERVER_CONNECTION_SHED, WARNING, EVENT_SERVER, "FD %i: Event server out of file descriptors, closed pending connection") \
+    LOGGER_ENTRY(EVENT_SERVER_BACKLOG_FAILED, WARNING, EVENT_SERVER, "FD %i: Event server failed to set backlog %i, error %ve") \
+    LOGGER_ENTRY(EVENT_SERVER_READ_PAUSED, DEBUG, EVENT_SERVER, "FD %i: Event server stopped reading, %llu bytes queued for write") \
+    LOGGER_ENTRY(EVENT_SERVER_READ_RESUMED, DEBUG, EVENT_SERVER, "FD %i: Event server resumed reading, %llu bytes queued for write") \
+    LOGGER_ENTRY(EVENT_SERVER_ZEROCOPY_LINGER_TIMEOUT, WARNING, EVENT_SERVER, "FD %i: Event server closing with %llu zerocopy buffers not acknowledged") \
     \
     LOGGER_ENTRY(IOT_EVENT_SERVER_READ_FAILED, DEBUG, IOT_EVENT_SERVER, "IOT Event Server peer read failed with error %vE") \
     LOGGER_ENTRY(IOT_EVENT_SERVER_WRITE_FAILED, ERROR, IOT_EVENT_SERVER, "IOT Event Server peer write failed with error %vE") \
@@ -175,6 +207,7 @@ namespace rohit {
     \
     LOGGER_ENTRY(WEB_SERVER_NO_EXTENSION, DEBUG, SYSTEM, "Web Server, file without extension is not supported, ignoring") \
     LOGGER_ENTRY(WEB_SERVER_UNSUPPORTED_EXTENSION, DEBUG, SYSTEM, "Web Server, unsupported file extension, ignoring") \
+    LOGGER_ENTRY(WEB_SERVER_SENDFILE_FD_FAILED, WARNING, SYSTEM, "Web Server, unable to create sendfile descriptor, body will be copied, error %ve") \
     \
     LOGGER_ENTRY(MAX_LOG, VERBOSE, TEST, "Max log no entry must be made beyond this") \
     LIST_DEFINITION_END
@@ -0,0 +1,100 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <iot/core/io_buffer.hh>
+#include <algorithm>
+#include <cstring>
+
+namespace rohit {
+
+// Bytes received on one connection that are not yet consumed. Buffer is
+// taken from io_buffer pool on first read and given back once every byte
+// is consumed, so idle connection holds no buffer. Message spanning reads
+// grows buffer to larger size class, unconsumed data is kept in order.
+class stream_buffer {
+private:
+    io_buffer *io { nullptr };
+    size_t begin { 0 };
+    size_t end { 0 };
+
+public:
+    inline stream_buffer() { }
+    inline stream_buffer(stream_buffer &&old) : io(old.io), begin(old.begin), end(old.end) {
+        old.io = nullptr;
+        old.begin = old.end = 0;
+    }
+
+    stream_buffer(const stream_buffer &) = delete;
+    stream_buffer &operator=(const stream_buffer &) = delete;
+
+    inline ~stream_buffer() { reset(); }
+
+    // Makes at least free_size bytes available after end, false if
+    // unconsumed data and free_size do not fit in max_size
+    inline bool reserve(const size_t free_size, const size_t max_size) {
+        if (io == nullptr) {
+            io = io_buffer::alloc(std::max(free_size, config::socket_peer_read_size));
+            return true;
+        }
+
+        if (io->capacity() - end >= free_size) return true;
+
+        const size_t data_size = end - begin;
+        if (io->capacity() - data_size >= free_size) {
+            std::memmove(io->data(), io->data() + begin, data_size);
+        } else {
+            if (data_size + free_size > max_size) return false;
+            auto new_io = io_buffer::alloc(data_size + free_size);
+            std::copy(io->data() + begin, io->data() + end, new_io->data());
+            io->release();
+            io = new_io;
+        }
+        begin = 0;
+        end = data_size;
+        return true;
+    }
+
+    // Space after unconsumed data, valid after reserve
+    inline uint8_t *tail() { return io->data() + end; }
+    inline size_t tail_size() const { return io ? io->capacity() - end : 0; }
+
+    // Bytes written at tail are added to unconsumed data
+    inline void commit(const size_t size) {
+        end += size;
+        if (begin == end) reset();
+    }
+
+    inline const uint8_t *data() const { return io ? io->data() + begin : nullptr; }
+    constexpr size_t size() const { return end - begin; }
+    constexpr bool empty() const { return begin == end; }
+    inline size_t capacity() const { return io ? io->capacity() : 0; }
+
+    // Removes size bytes from front, buffer goes back to pool when empty
+    inline void consume(const size_t size) {
+        begin += size;
+        if (begin >= end) reset();
+    }
+
+    inline void reset() {
+        if (io) {
+            io->release();
+            io = nullptr;
+        }
+        begin = end = 0;
+    }
+};
+
+} // namespace rohit
@@ -17,6 +17,7 @@
 #include "core/error.hh"
 #include "core/guid.hh"
 #include <algorithm>
+#include <cstring>
 #include <string>
 
 namespace rohit {
@@ -31,6 +32,7 @@ namespace message {
     MESSAGE_CODE_ENTRY(SUCCESS) \
     MESSAGE_CODE_ENTRY(COMMAND) \
     MESSAGE_CODE_ENTRY(BAD_REQUEST) \
+    MESSAGE_CODE_ENTRY(DISCONNECT) \
     LIST_DEFINITION_END
 
 #define MESSAGE_OPERATION_LIST \
@@ -177,6 +179,29 @@ public:
     constexpr Success() : Base(Code::SUCCESS) { }
 } __attribute__((packed));
 
+// Sent by server before it closes device connection
+enum class DisconnectReason : uint16_t {
+    SERVER_SHUTDOWN,
+    SERVER_BUSY,        // Sent instead of accepting connection when server is overloaded
+};
+
+struct Disconnect : public Base {
+private:
+    DisconnectReason    reason;
+
+    // Device waits this long before reconnecting, spreads reconnects
+    uint32_t            reconnect_delay_in_ms;
+
+public:
+    constexpr Disconnect(const DisconnectReason reason, const uint32_t reconnect_delay_in_ms) :
+        Base(Code::DISCONNECT),
+        reason(reason),
+        reconnect_delay_in_ms(reconnect_delay_in_ms) {}
+
+    constexpr DisconnectReason get_reason() const { return reason; }
+    constexpr uint32_t get_reconnect_delay_in_ms() const { return reconnect_delay_in_ms; }
+} __attribute__((packed));
+
 struct Command : public Base {
 public:
     static const constexpr size_t MAX_COMMAND = 16;
@@ -226,6 +251,38 @@ public:
 
 };
 
+// Size of message at start of buffer, 0 till enough of it is received to
+// know. Command carries its own count, rest are fixed by message code.
+// Command with invalid count is sized to its header, verify() rejects it.
+inline size_t frame_length(const uint8_t *buffer, const size_t size) {
+    if (size < sizeof(Base)) return 0;
+
+    Code code;
+    std::memcpy(&code, buffer, sizeof(code));
+    switch(code) {
+        case Code::REGISTER:
+            return sizeof(Register);
+
+        case Code::CONNECT:
+            return sizeof(Connect256);
+
+        case Code::DISCONNECT:
+            return sizeof(Disconnect);
+
+        case Code::COMMAND: {
+            constexpr size_t header_size = sizeof(Base) + sizeof(uint32_t);
+            if (size < header_size) return 0;
+            uint32_t command_count;
+            std::memcpy(&command_count, buffer + sizeof(Base), sizeof(command_count));
+            if (command_count > Command::MAX_COMMAND) return header_size;
+            return header_size + sizeof(CommandEntry) * command_count;
+        }
+
+        default:
+            return sizeof(Base);
+    }
+}
+
 } //namespace message
 } //namespace rohit
 
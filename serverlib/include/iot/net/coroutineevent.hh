@@ -0,0 +1,279 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <iot/net/serverevent.hh>
+#include <iot/core/memory.hh>
+#include <coroutine>
+#include <new>
+
+namespace rohit {
+
+// Return type of connection handler coroutine.
+// Handler starts on first event and frame is freed with its executor.
+class event_coroutine {
+public:
+    struct promise_type {
+        bool failed { false };
+
+        inline event_coroutine get_return_object() {
+            return event_coroutine(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        constexpr std::suspend_always initial_suspend() noexcept { return { }; }
+        constexpr std::suspend_always final_suspend() noexcept { return { }; }
+        constexpr void return_void() { }
+        inline void unhandled_exception() { failed = true; }
+
+        // Frame comes from allocator, large frames from heap
+        static constexpr bool use_allocator(const size_t size) {
+            return ((size + 7) & ~7) <= memory::max_allocation_size;
+        }
+
+        static inline void *operator new(const size_t size) {
+            if (use_allocator(size)) return allocator.alloc(size);
+            return ::operator new(size);
+        }
+
+        static inline void operator delete(void *frame, const size_t size) {
+            if (use_allocator(size)) {
+                allocator.free(frame);
+            } else {
+                ::operator delete(frame);
+            }
+        }
+    };
+
+private:
+    std::coroutine_handle<promise_type> handle;
+
+public:
+    constexpr event_coroutine() : handle(nullptr) { }
+    constexpr event_coroutine(std::coroutine_handle<promise_type> handle) : handle(handle) { }
+    inline event_coroutine(event_coroutine &&other) : handle(other.handle) { other.handle = nullptr; }
+
+    inline event_coroutine &operator=(event_coroutine &&other) {
+        if (this != &other) {
+            if (handle) handle.destroy();
+            handle = other.handle;
+            other.handle = nullptr;
+        }
+        return *this;
+    }
+
+    event_coroutine(const event_coroutine &) = delete;
+    event_coroutine &operator=(const event_coroutine &) = delete;
+
+    inline ~event_coroutine() { if (handle) handle.destroy(); }
+
+    constexpr bool is_null() const { return handle == nullptr; }
+    inline bool done() const { return handle.done(); }
+    inline bool failed() const { return handle.promise().failed; }
+    inline void resume() { handle.resume(); }
+};
+
+// Peer event written as coroutine, derived class implements handler().
+// Handler is resumed only from execute and timeout of this executor,
+// so it always runs on loop thread owning the connection and is never
+// resumed concurrently. I/O is attempted first and handler is suspended
+// only if socket would block. Only handler itself can co_await.
+// Peer hang up closes executor without resuming handler, suspended
+// frame is destroyed along with executor.
+template <bool use_ssl>
+class coroutine_event : public serverpeerevent<use_ssl> {
+public:
+    static constexpr bool movable = false;
+
+protected:
+    using serverpeerevent<use_ssl>::peer_id;
+    using serverpeerevent<use_ssl>::client_state;
+
+private:
+    enum class pending_t {
+        NONE,
+        ACCEPT,
+        READ,
+        WRITE,
+        SLEEP,
+    };
+
+    event_coroutine coroutine { };
+    event_timer sleep_timer;
+
+    pending_t pending { pending_t::NONE };
+    uint8_t *io_buffer { nullptr };
+    size_t io_size { 0 };
+    size_t io_done { 0 };
+    err_t io_result { err_t::SUCCESS };
+
+    static inline bool would_block(const err_t err) {
+        if (err == err_t::SOCKET_RETRY) return true;
+        return (err == err_t::RECEIVE_FAILURE || err == err_t::SEND_FAILURE) && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+
+    // Returns true if pending I/O is complete
+    inline bool try_io() {
+        switch(pending) {
+        case pending_t::ACCEPT: {
+            if constexpr (use_ssl) {
+                io_result = peer_id.accept();
+                if (io_result == err_t::SOCKET_RETRY) return false;
+            } else {
+                io_result = err_t::SUCCESS;
+            }
+            break;
+        }
+
+        case pending_t::READ: {
+            size_t read_len = 0;
+            io_result = peer_id.read(io_buffer, io_size, read_len);
+            if (would_block(io_result)) return false;
+            io_done = isFailure(io_result) ? 0 : read_len;
+            break;
+        }
+
+        case pending_t::WRITE: {
+            while (io_done < io_size) {
+                size_t written = 0;
+                io_result = peer_id.write(io_buffer + io_done, io_size - io_done, written);
+                if (io_result == err_t::SOCKET_RETRY || io_result == err_t::SUCCESS) io_done += written;
+                if (io_result == err_t::SUCCESS) continue;
+                if (would_block(io_result)) return false;
+                break;
+            }
+            break;
+        }
+
+        case pending_t::SLEEP:
+            return false;
+
+        case pending_t::NONE:
+            break;
+        }
+
+        pending = pending_t::NONE;
+        return true;
+    }
+
+    inline void resume() {
+        coroutine.resume();
+        if (coroutine.done()) {
+            if (coroutine.failed()) {
+                log<log_t::EVENT_SERVER_COROUTINE_FAILED>(static_cast<int>(peer_id));
+            }
+            close();
+        }
+    }
+
+    // Completes immediately if I/O does not block, otherwise execute resumes
+    template <typename RESULT>
+    class io_awaitable {
+    private:
+        coroutine_event &event;
+        RESULT coroutine_event::*const result;
+
+    public:
+        constexpr io_awaitable(coroutine_event &event, RESULT coroutine_event::*const result)
+            : event(event), result(result) { }
+
+        inline bool await_ready() { return event.try_io(); }
+        constexpr void await_suspend(std::coroutine_handle<>) { }
+        inline RESULT await_resume() { return event.*result; }
+    };
+
+public:
+    inline coroutine_event(socket_variant_t<use_ssl>::type &peer_id)
+        : serverpeerevent<use_ssl>(peer_id), sleep_timer(this) { }
+
+    // SSL handshake, SUCCESS for plain socket
+    inline io_awaitable<err_t> accept() {
+        pending = pending_t::ACCEPT;
+        return { *this, &coroutine_event::io_result };
+    }
+
+    // Returns bytes read, 0 if peer closed or read failed
+    inline io_awaitable<size_t> read(uint8_t *buffer, const size_t size) {
+        pending = pending_t::READ;
+        io_buffer = buffer;
+        io_size = size;
+        io_done = 0;
+        return { *this, &coroutine_event::io_done };
+    }
+
+    // Completes once whole buffer is written, buffer must live till then
+    inline io_awaitable<err_t> write(const uint8_t *buffer, const size_t size) {
+        pending = pending_t::WRITE;
+        io_buffer = const_cast<uint8_t *>(buffer);
+        io_size = size;
+        io_done = 0;
+        return { *this, &coroutine_event::io_result };
+    }
+
+    // Resumes after timeout on wheel of owning loop thread
+    inline auto sleep(const uint64_t timeout_in_ms) {
+        struct awaitable {
+            coroutine_event &self;
+            const uint64_t timeout_in_ms;
+            constexpr bool await_ready() const { return timeout_in_ms == 0; }
+            inline void await_suspend(std::coroutine_handle<>) {
+                self.pending = pending_t::SLEEP;
+                ctx.arm_timer(self.sleep_timer, timeout_in_ms);
+            }
+            constexpr void await_resume() const { }
+        };
+        return awaitable { *this, timeout_in_ms };
+    }
+
+protected:
+    virtual event_coroutine handler() = 0;
+
+    void execute() override {
+        if (client_state == state_t::SOCKET_PEER_CLOSED) return;
+        if (coroutine.is_null()) {
+            coroutine = handler();
+            resume();
+            return;
+        }
+
+        if (pending != pending_t::NONE && pending != pending_t::SLEEP && try_io()) {
+            resume();
+        }
+    }
+
+    void timeout(event_timer *timer) override {
+        if (timer == &sleep_timer) {
+            if (pending == pending_t::SLEEP) {
+                pending = pending_t::NONE;
+                resume();
+            }
+            return;
+        }
+        serverpeerevent<use_ssl>::timeout(timer);
+    }
+
+    // Write in progress is completed, handler waiting for anything else
+    // is not resumed again. Drain is called after every resume.
+    void drain() override {
+        if (client_state == state_t::SOCKET_PEER_CLOSE || client_state == state_t::SOCKET_PEER_CLOSED) return;
+        if (pending != pending_t::WRITE) close();
+    }
+
+    void close() override {
+        ctx.cancel_timer(sleep_timer);
+        serverpeerevent<use_ssl>::close();
+    }
+}; // class coroutine_event
+
+} // namespace rohit
@@ -14,81 +14,370 @@
 
 #pragma once
 
+#include <iot/core/io_buffer.hh>
+#include <iot/core/stream_buffer.hh>
 #include <iot/core/pthread_helper.hh>
 #include <iot/states/event_distributor.hh>
 #include <iot/states/statesentry.hh>
 #include <iot/states/states.hh>
 #include <iot/net/socket.hh>
 #include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <fcntl.h>
+#include <limits.h>
+#include <vector>
 
 namespace rohit {
 
+// Write backpressure of one listener, shared with its peers. Peer stops
+// reading once its queued writes reach high and reads again once they are
+// written down to low. Counters change only when a peer crosses a mark.
+struct write_watermark {
+    size_t high { config::socket_write_high_watermark };
+    size_t low { config::socket_write_low_watermark };
+
+    std::atomic<int> paused_count { 0 };
+    std::atomic<uint64_t> pause_total { 0 };
+    std::atomic<size_t> max_queued { 0 };
+};
 
 template <typename peerevent, bool use_ssl, bool use_lock = use_ssl>
 class serverevent : public event_executor, public pthread_lock_c<use_lock> {
 private:
+    // In sharded mode every loop thread gets its own listener on same port
+    // Each listener is separate executor so that accept of one shard
+    // is never merged into execute of other shard
+    class shard_listener : public event_executor {
+    private:
+        serverevent &server;
+        server_socket_t listen_id;
+
+    public:
+        inline shard_listener(serverevent &server, const int port)
+            : server(server), listen_id(port, true) { }
+
+        inline int get_listen_id() const { return listen_id; }
+        inline void set_non_blocking() { listen_id.set_non_blocking(); }
+        inline bool set_backlog(const int backlog) { return listen_id.set_backlog(backlog); }
+        inline bool set_busy_poll(const int busy_poll_in_us) {
+            event_executor::set_busy_poll(busy_poll_in_us);
+            return listen_id.set_busy_poll(get_busy_poll());
+        }
+        inline void set_tcp_profile(const tcp_profile &profile) { apply_tcp_profile(listen_id, profile); }
+
+        void execute() override { server.accept_all(listen_id); }
+        void flush() override { /* Do nothing */ }
+
+        // Runs on thread of its own shard
+        void drain() override {
+            log<log_t::EVENT_SERVER_DRAINING>(static_cast<int>(listen_id));
+            close();
+        }
+
+        void close() override {
+            listen_id.close();
+            if (server.evtdist) server.evtdist->untrack(this);
+        }
+    };
+
     server_socket_variant_t<use_ssl>::type socket_id;
     const int port;
     const int maxconnection;
+    const bool reuseport;
+    int backlog { config::socket_backlog };
+    std::vector<std::unique_ptr<shard_listener>> shard_listeners;
+    event_distributor *evtdist { nullptr };
+
+    // Shared with peers, peer counts itself down when its socket closes
+    std::shared_ptr<std::atomic<int>> connection_count { std::make_shared<std::atomic<int>>(0) };
+    std::atomic<uint64_t> rejected_count { 0 };
+
+    // Reserved descriptor, given up to accept and close one pending
+    // connection when process runs out of descriptors. Edge triggered
+    // listener is not woken again for connections left in its queue.
+    int spare_fd { ::open("/dev/null", O_RDONLY | O_CLOEXEC) };
+    std::mutex spare_lock;
+    std::atomic<uint64_t> shed_count { 0 };
+
+    std::shared_ptr<write_watermark> watermark { std::make_shared<write_watermark>() };
+
+    // Peer buffers of at least this size are sent with MSG_ZEROCOPY, 0 disables
+    size_t zerocopy_min_size { 0 };
+
+    tcp_profile profile { };
+
+    // Accept pacing, connection is admitted if it is not due later than
+    // burst from now. 0 interval disables pacing.
+    uint64_t accept_interval_ns { 0 };
+    uint64_t accept_burst_ns { 0 };
+    std::atomic<uint64_t> accept_due_ns { 0 };
+
+    inline bool admit() {
+        if (accept_interval_ns != 0) {
+            const auto now = cycle_clock::to_ns(cycle_clock::now());
+            auto due = accept_due_ns.load(std::memory_order_relaxed);
+            while(true) {
+                const auto start = std::max(due, now);
+                if (start > now + accept_burst_ns) return false;
+                if (accept_due_ns.compare_exchange_weak(due, start + accept_interval_ns, std::memory_order_relaxed)) break;
+            }
+        }
+
+        if (connection_count->fetch_add(1, std::memory_order_relaxed) >= maxconnection) {
+            connection_count->fetch_sub(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+    // Failure is logged, listener works with whatever options were set
+    static void apply_tcp_profile(socket_t &listen_id, const tcp_profile &profile) {
+        if (!listen_id.set_tcp_profile(profile)) {
+            log<log_t::SOCKET_SET_TCP_PROFILE_FAILED>(static_cast<int>(listen_id), errno);
+        }
+        if (profile.receive_buffer_size > 0 && listen_id.get_receive_buffer_size() < profile.receive_buffer_size) {
+            log<log_t::SOCKET_BUFFER_CLAMPED>(static_cast<int>(listen_id), profile.receive_buffer_size, listen_id.get_receive_buffer_size());
+        }
+        if (profile.send_buffer_size > 0 && listen_id.get_send_buffer_size() < profile.send_buffer_size) {
+            log<log_t::SOCKET_BUFFER_CLAMPED>(static_cast<int>(listen_id), profile.send_buffer_size, listen_id.get_send_buffer_size());
+        }
+    }
+
+    // No executor is created for rejected connection, peerevent may send
+    // its busy reply. TLS connection is closed without handshake.
+    template <typename socket_type>
+    inline void reject(const int listen_id, socket_type &peer_id) {
+        ++rejected_count;
+        log<log_t::EVENT_SERVER_CONNECTION_REJECTED>(
+            listen_id, static_cast<int>(peer_id), connection_count->load(std::memory_order_relaxed));
+        if constexpr (!use_ssl && requires { peerevent::reject(0); }) {
+            peerevent::reject(static_cast<int>(peer_id));
+            peer_id.discard_after_reply();
+        } else {
+            peer_id.discard();
+        }
+    }
+
+    // Returns true if queue is not empty, false when accept would block
+    // or spare descriptor is also taken
+    inline bool shed_pending(const int listen_id) {
+        std::lock_guard<std::mutex> lock(spare_lock);
+        if (spare_fd >= 0) ::close(spare_fd);
+        const auto peer_id = ::accept4(listen_id, NULL, NULL, SOCK_CLOEXEC);
+        const auto err = errno;
+        if (peer_id >= 0) ::close(peer_id);
+        spare_fd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+
+        if (peer_id >= 0) {
+            ++shed_count;
+            log<log_t::EVENT_SERVER_CONNECTION_SHED>(listen_id);
+            return true;
+        }
+        if (err != EAGAIN) log<log_t::EVENT_SERVER_ACCEPT_FAILED>(listen_id, err);
+        return false;
+    }
+
+    // Returns true if accept is to be tried again for rest of the queue
+    inline bool accept_failed(const int listen_id, const int err) {
+        switch(err) {
+        case ECONNABORTED:
+        case EINTR:
+            // Only this connection is lost, peer reset before accept
+            return true;
+
+        case EMFILE:
+        case ENFILE:
+            return shed_pending(listen_id);
+
+        default:
+            log<log_t::EVENT_SERVER_ACCEPT_FAILED>(listen_id, err);
+            return false;
+        }
+    }
 
 public:
     serverevent(const int port,
-                const int maxconnection = 10000);
+                const int maxconnection = 10000,
+                const bool reuseport = false);
 
     serverevent(const int port,
                 const char *const cert_file,
                 const char *const prikey_file,
-                const int maxconnection = 10000);
+                const int maxconnection = 10000,
+                const bool reuseport = false);
+
+    ~serverevent();
+
+    // Must be called before init, peers of this listener are busy polled
+    // and loop thread spins only after serving them. 0 disables it.
+    inline void set_busy_poll(const int busy_poll_in_us) { event_executor::set_busy_poll(busy_poll_in_us); }
+
+    // Must be called before init, TLS record encryption is moved to kernel
+    // where supported so that file entries are sent with SSL_sendfile
+    inline void set_ktls(const bool ktls) {
+        static_assert(use_ssl, "kTLS is only for SSL server");
+        socket_id.set_ktls(ktls);
+    }
+
+    // Must be called before init, 0 keeps config::socket_backlog
+    inline void set_backlog(const int backlog) {
+        if (backlog > 0) this->backlog = backlog;
+    }
+
+    // Must be called before init. Connections above rate are rejected
+    // once burst is used up. 0 disables pacing.
+    inline void set_accept_rate(const uint64_t per_second, const uint64_t burst = 1) {
+        accept_interval_ns = per_second == 0 ? 0 : 1000000000ULL / per_second;
+        accept_burst_ns = accept_interval_ns * (burst == 0 ? 0 : burst - 1);
+    }
+
+    // Must be called before init. Saves kernel copy of large responses
+    // where it pins pages instead, below min_size copy is cheaper. 0 disables.
+    inline void set_zerocopy(const size_t min_size) {
+        static_assert(!use_ssl, "Zerocopy is only for plain server, TLS encrypts into its own buffer");
+        zerocopy_min_size = min_size;
+    }
+
+    // Must be called before init, set on listening socket and inherited by
+    // every accepted socket so accept costs no extra system call
+    inline void set_tcp_profile(const tcp_profile &profile) { this->profile = profile; }
 
+    // Must be called before init, 0 keeps config value
+    inline void set_write_watermark(const size_t high, const size_t low) {
+        if (high > 0) watermark->high = high;
+        if (low > 0) watermark->low = low;
+        if (watermark->low > watermark->high) watermark->low = watermark->high;
+    }
+
+    inline int get_connection_count() const { return connection_count->load(std::memory_order_relaxed); }
+    inline uint64_t get_rejected_count() const { return rejected_count.load(std::memory_order_relaxed); }
+    inline uint64_t get_shed_count() const { return shed_count.load(std::memory_order_relaxed); }
+
+    // Peers not reading now, times any peer stopped reading and largest
+    // write queue of peer when it stopped reading
+    inline int get_read_paused_count() const { return watermark->paused_count.load(std::memory_order_relaxed); }
+    inline uint64_t get_read_pause_total() const { return watermark->pause_total.load(std::memory_order_relaxed); }
+    inline size_t get_max_write_queued() const { return watermark->max_queued.load(std::memory_order_relaxed); }
+
+    // Listeners and accepted peers are tracked, drain stops accepting
     inline void init(event_distributor &evtdist) {
+        this->evtdist = &evtdist;
         socket_id.set_non_blocking();
-        evtdist.add(socket_id, EPOLLIN, this);
-    }
+        if (backlog != config::socket_backlog && !socket_id.set_backlog(backlog)) {
+            log<log_t::EVENT_SERVER_BACKLOG_FAILED>(static_cast<int>(socket_id), backlog, errno);
+        }
+        if (get_busy_poll() > 0) {
+            if (!socket_id.set_busy_poll(get_busy_poll())) {
+                log<log_t::SOCKET_SET_BUSY_POLL_FAILED>(static_cast<int>(socket_id), errno);
+            }
+            log<log_t::EVENT_SERVER_BUSY_POLL_ENABLED>(static_cast<int>(socket_id), get_busy_poll());
+        }
+        apply_tcp_profile(socket_id, profile);
 
+        if (!evtdist.is_sharded()) {
+            evtdist.add(socket_id, EPOLLIN, this);
+            evtdist.track(this);
+            return;
+        }
 
-    void execute() override {
-        log<log_t::EVENT_SERVER_RECEIVED_EVENT>(static_cast<int>(socket_id));
-        try {
-            while(true) {
-                auto peer_id = socket_id.accept();
+        if (!reuseport) {
+            // One listener waited on by every shard, only one thread is woken
+            evtdist.add_exclusive(socket_id, EPOLLIN, this);
+            evtdist.track(this);
+            return;
+        }
+
+        // First shard uses primary socket, rest of the shards get their own listener
+        evtdist.add_shard(0, socket_id, EPOLLIN, this);
+        evtdist.track(this);
+        for(size_t shard_index = 1; shard_index < evtdist.get_shard_count(); ++shard_index) {
+            auto listener = new shard_listener(*this, port);
+            listener->set_non_blocking();
+            if (backlog != config::socket_backlog && !listener->set_backlog(backlog)) {
+                log<log_t::EVENT_SERVER_BACKLOG_FAILED>(listener->get_listen_id(), backlog, errno);
+            }
+            if (get_busy_poll() > 0 && !listener->set_busy_poll(get_busy_poll())) {
+                log<log_t::SOCKET_SET_BUSY_POLL_FAILED>(listener->get_listen_id(), errno);
+            }
+            listener->set_tcp_profile(profile);
+            shard_listeners.emplace_back(listener);
+            evtdist.add_shard(shard_index, listener->get_listen_id(), EPOLLIN, listener);
+            evtdist.track(listener);
+        }
+    }
+
+    // Accepted peers are added to epoll of calling thread
+    // in sharded mode peer stays on the accepting thread
+    inline void accept_all(const int listen_id) {
+        log<log_t::EVENT_SERVER_RECEIVED_EVENT>(listen_id);
+        while(true) {
+            try {
+                ipv6_socket_addr_t peer_addr;
+                auto peer_id = socket_id.accept(listen_id, peer_addr);
                 if (peer_id.is_null()) break;
-                const auto non_blocking = peer_id.set_non_blocking();
-                if (!non_blocking) {
-                    log<log_t::SOCKET_SET_NONBLOCKING_FAILED>(static_cast<int>(peer_id));
+                if (!admit()) {
+                    reject(listen_id, peer_id);
+                    continue;
                 }
                 peerevent *p_peerevent = new peerevent(peer_id);
                 assert(p_peerevent);
+                p_peerevent->set_peer_addr(peer_addr);
+                p_peerevent->set_connection_count(connection_count);
+                p_peerevent->set_write_watermark(watermark);
+                if constexpr (!use_ssl) p_peerevent->set_zerocopy(zerocopy_min_size);
+                if constexpr (use_ssl) p_peerevent->set_cork(profile.cork);
+                p_peerevent->set_busy_poll(get_busy_poll());
                 p_peerevent->execute_protector();
                 if constexpr (peerevent::movable) {
                     if (p_peerevent->get_client_state() != state_t::SERVEREVENT_MOVED) {
                         ctx.add_event(peer_id, EPOLLIN | EPOLLOUT, p_peerevent);
+                        ctx.track_event(p_peerevent);
                     }
                 } else {
                     ctx.add_event(peer_id, EPOLLIN | EPOLLOUT, p_peerevent);
+                    ctx.track_event(p_peerevent);
                 }
-                log<log_t::EVENT_SERVER_PEER_CREATED>(static_cast<int>(socket_id), static_cast<int>(peer_id), peer_id.get_peer_ipv6_addr());
-            }
-        } catch (const exception_t e) {
-            if (e == err_t::ACCEPT_FAILURE) {
-                log<log_t::EVENT_SERVER_ACCEPT_FAILED>(static_cast<int>(socket_id), errno);
+                log<log_t::EVENT_SERVER_PEER_CREATED>(listen_id, static_cast<int>(peer_id), peer_addr);
+            } catch (const exception_t e) {
+                const auto err = errno;
+                if (e != err_t::ACCEPT_FAILURE || !accept_failed(listen_id, err)) break;
             }
         }
     }
 
+    void execute() override {
+        accept_all(socket_id);
+    }
+
     void flush() override { /* Do nothing */ }
 
+    // Each shard listener drains itself on its own thread
+    void drain() override {
+        log<log_t::EVENT_SERVER_DRAINING>(static_cast<int>(socket_id));
+        socket_id.close();
+        if (evtdist) evtdist->untrack(this);
+    }
+
     void close() override {
+        for(auto &listener: shard_listeners) {
+            listener->close();
+        }
         socket_id.close();
+        if (evtdist) evtdist->untrack(this);
     }
 };
 
 template <typename peerevent, bool use_ssl, bool use_lock>
 inline serverevent<peerevent, use_ssl, use_lock>::serverevent(
     const int port,
-    const int maxconnection)
-        :   socket_id(port),
+    const int maxconnection,
+    const bool reuseport)
+        :   socket_id(port, reuseport),
             port(port),
-            maxconnection(maxconnection) {
+            maxconnection(maxconnection),
+            reuseport(reuseport) {
     static_assert(!use_ssl, "Provide cert_file and prikey_file parameters");
 }
 
@@ -97,39 +386,111 @@ inline serverevent<peerevent, use_ssl, use_lock>::serverevent(
         const int port,
         const char *const cert_file,
         const char *const prikey_file,
-        const int maxconnection)
-            :   socket_id(port, cert_file, prikey_file),
+        const int maxconnection,
+        const bool reuseport)
+            :   socket_id(port, cert_file, prikey_file, reuseport),
                 port(port),
-                maxconnection(maxconnection) {
+                maxconnection(maxconnection),
+                reuseport(reuseport) {
     static_assert(use_ssl, "cert_file and prikey_file parameters require only for SSL");
 }
 
+template <typename peerevent, bool use_ssl, bool use_lock>
+inline serverevent<peerevent, use_ssl, use_lock>::~serverevent() {
+    if (spare_fd >= 0) ::close(spare_fd);
+}
+
 class serverpeerevent_base {
 protected:
+    // Buffer entry holds one reference of io, static entry has no io.
+    // File entry has no buffer, it is sent with sendfile from file_fd,
+    // owner keeps file_fd open till entry is written
     struct write_entry {
         const uint8_t *buffer;
         size_t written;
         size_t size;
+        io_buffer *io;
+        int file_fd;
+        std::shared_ptr<const void> owner;
+
+        constexpr bool is_file() const { return file_fd >= 0; }
     };
 
-    std::queue<write_entry> write_queue;
+    // Deque so that write_all can gather many entries in one syscall
+    std::deque<write_entry> write_queue;
+
+    // Write syscalls issued for this connection
+    uint64_t flush_count { 0 };
+
+    // Bytes of all entries in write_queue, written part of front included
+    size_t write_queued { 0 };
+
+    // Data read but not yet consumed by handler, partial message waits
+    // here for rest of it
+    stream_buffer receive_buffer;
 
 public:
     inline serverpeerevent_base() : write_queue() { }
-    inline serverpeerevent_base(serverpeerevent_base &&old) : write_queue(std::move(old.write_queue)) { }
+    inline serverpeerevent_base(serverpeerevent_base &&old)
+        : write_queue(std::move(old.write_queue)),
+          flush_count(old.flush_count),
+          write_queued(old.write_queued),
+          receive_buffer(std::move(old.receive_buffer)) {
+        old.write_queue.clear();
+        old.write_queued = 0;
+    }
+
+    inline ~serverpeerevent_base() { clear(); }
+
+    // Takes over caller's reference of io
+    inline void push_write(io_buffer *io, size_t size) {
+        assert(io && size <= io->capacity());
+        write_queue.push_back({io->data(), 0, size, io, -1, nullptr});
+        write_queued += size;
+    }
+
+    // Part of shared buffer, caller passes reference for this entry
+    inline void push_write(io_buffer *io, const uint8_t *buffer, size_t size) {
+        assert(io && buffer >= io->data() && buffer + size <= io->data() + io->capacity());
+        write_queue.push_back({buffer, 0, size, io, -1, nullptr});
+        write_queued += size;
+    }
 
-    inline void push_write(const uint8_t *buffer, size_t size) {
+    // Buffer must outlive connection, it is never freed
+    inline void push_write_static(const uint8_t *buffer, size_t size) {
         assert(buffer);
-        write_queue.push({buffer, 0, size});
+        write_queue.push_back({buffer, 0, size, nullptr, -1, nullptr});
+        write_queued += size;
     }
 
-    inline void pop_write() { write_queue.pop(); }
+    // Only for peers whose socket can_sendfile()
+    inline void push_write_file(const int file_fd, size_t size, std::shared_ptr<const void> owner) {
+        assert(file_fd >= 0);
+        write_queue.push_back({nullptr, 0, size, nullptr, file_fd, std::move(owner)});
+        write_queued += size;
+    }
+
+    inline void pop_write() {
+        auto io = write_queue.front().io;
+        if (io) io->release();
+        write_queued -= write_queue.front().size;
+        write_queue.pop_front();
+    }
 
     inline write_entry &get_write_buffer() { return write_queue.front(); }
 
     inline bool is_write_left() { return !write_queue.empty(); }
 
-    inline void clear() { std::queue<write_entry>().swap(write_queue);}
+    inline void clear() {
+        while (is_write_left()) pop_write();
+    }
+
+    constexpr uint64_t get_flush_count() const { return flush_count; }
+
+    // Bytes still to be written
+    inline size_t get_write_queued() const {
+        return write_queue.empty() ? 0 : write_queued - write_queue.front().written;
+    }
 
 };
 
@@ -138,21 +499,147 @@ class serverpeerevent : public event_executor, public serverpeerevent_base {
 protected:
     socket_variant_t<use_ssl>::type peer_id;
     state_t client_state;
+    event_timer idle_timer;
+
+    // Captured once for connection, local address is read on first use
+    ipv6_socket_addr_t peer_addr { };
+    ipv6_socket_addr_t local_addr { };
+    bool local_addr_valid { false };
+
+    // Entries coalesced into TLS record that has to be retried, 0 when none
+    size_t retry_entry_count { 0 };
+
+    // Active connections of listener, decremented once socket is closed
+    std::shared_ptr<std::atomic<int>> connection_count { };
+
+    // Listener watermarks, config values are used without listener
+    std::shared_ptr<write_watermark> watermark { };
+    bool read_paused { false };
+
+    // Buffers kernel may still read for zerocopy sends, one reference for
+    // every send that covered buffer. 0 min size sends copy.
+    struct zerocopy_hold {
+        uint32_t send_index;
+        io_buffer *io;
+    };
+    std::vector<zerocopy_hold> zerocopy_holds { };
+    size_t zerocopy_min_size { 0 };
+    uint32_t zerocopy_send_count { 0 };
+
+    // TLS records of one flush are corked into full segments
+    bool cork { false };
+
+    // Connection is closed if refresh is not called again within timeout
+    inline void refresh_idle_timer(const uint64_t timeout_in_ms) {
+        ctx.arm_timer(idle_timer, timeout_in_ms);
+    }
 
 public:
     inline serverpeerevent(socket_variant_t<use_ssl>::type &peer_id)
               : peer_id(peer_id),
-                client_state(use_ssl ? state_t::SOCKET_PEER_ACCEPT : state_t::SOCKET_PEER_READ) { }
+                client_state(use_ssl ? state_t::SOCKET_PEER_ACCEPT : state_t::SOCKET_PEER_READ),
+                idle_timer(this) { }
 
     inline serverpeerevent(serverpeerevent &&peerevent)
         :   serverpeerevent_base(std::move(peerevent)),
             peer_id(std::move(peerevent.peer_id)),
-            client_state(peerevent.client_state) { 
+            client_state(peerevent.client_state),
+            idle_timer(this),
+            peer_addr(peerevent.peer_addr),
+            local_addr(peerevent.local_addr),
+            local_addr_valid(peerevent.local_addr_valid),
+            retry_entry_count(peerevent.retry_entry_count),
+            connection_count(std::move(peerevent.connection_count)),
+            watermark(std::move(peerevent.watermark)),
+            read_paused(peerevent.read_paused),
+            zerocopy_holds(std::move(peerevent.zerocopy_holds)),
+            zerocopy_min_size(peerevent.zerocopy_min_size),
+            zerocopy_send_count(peerevent.zerocopy_send_count),
+            cork(peerevent.cork) { 
+        error_queue = peerevent.error_queue;
+        busy_poll_in_us = peerevent.busy_poll_in_us;
+        if (peerevent.idle_timer.is_armed()) {
+            // Idle time left moves to new executor, source is never executed again
+            const auto idle_in_ms = timer_wheel::remaining_in_ms(peerevent.idle_timer);
+            ctx.cancel_timer(peerevent.idle_timer);
+            ctx.arm_timer(idle_timer, idle_in_ms);
+        }
+        peerevent.zerocopy_holds.clear();
         peerevent.client_state = state_t::SERVEREVENT_MOVED;
     }
 
+    inline ~serverpeerevent() { release_zerocopy(); }
+
     constexpr state_t get_client_state() const { return client_state; }
 
+    // Set by serverevent from accept, peer is never asked again
+    inline void set_peer_addr(const ipv6_socket_addr_t &addr) { peer_addr = addr; }
+    inline void set_connection_count(const std::shared_ptr<std::atomic<int>> &count) { connection_count = count; }
+    inline void set_write_watermark(const std::shared_ptr<write_watermark> &watermark) { this->watermark = watermark; }
+    constexpr bool is_read_paused() const { return read_paused; }
+
+    // Plain socket already gathers header with body and holds it with MSG_MORE
+    inline void set_cork(const bool cork) { this->cork = cork; }
+
+    // Must be called before first write, plain socket buffers of at least
+    // min_size are sent in place. Ignored for TLS and where unsupported.
+    inline void set_zerocopy(const size_t min_size) {
+        if constexpr (!use_ssl) {
+            if (min_size == 0) return;
+            if (!peer_id.set_zerocopy()) {
+                log<log_t::SOCKET_ZEROCOPY_UNAVAILABLE>(static_cast<int>(peer_id), errno);
+                return;
+            }
+            zerocopy_min_size = min_size;
+            error_queue = true;
+        }
+    }
+
+    constexpr bool is_zerocopy() const { return zerocopy_min_size != 0; }
+    inline size_t get_zerocopy_held() const { return zerocopy_holds.size(); }
+    constexpr const ipv6_socket_addr_t &get_peer_addr() const { return peer_addr; }
+
+    inline const ipv6_socket_addr_t &get_local_addr() {
+        if (!local_addr_valid) {
+            local_addr = peer_id.get_local_ipv6_addr();
+            local_addr_valid = true;
+        }
+        return local_addr;
+    }
+
+    void timeout(event_timer *timer) override {
+        if (timer == &idle_timer) {
+            if (client_state == state_t::SOCKET_PEER_CLOSE && !zerocopy_holds.empty()) {
+                // Peer never acknowledged, nothing is sent from buffers after close
+                log<log_t::EVENT_SERVER_ZEROCOPY_LINGER_TIMEOUT>(static_cast<int>(peer_id), static_cast<uint64_t>(zerocopy_holds.size()));
+                release_zerocopy();
+            } else {
+                log<log_t::EVENT_SERVER_IDLE_TIMEOUT>(static_cast<int>(peer_id));
+            }
+            close();
+        }
+    }
+
+    // Appends what socket has to receive_buffer, handler consumes complete
+    // messages and leaves partial one for next read
+    err_t receive(size_t &read_length);
+
+    // False while queued writes are above high watermark, handler must not
+    // read. Peer is executed on writable and reads again below low watermark.
+    bool can_read();
+
+    // Zerocopy buffers are held for every send and released once kernel
+    // reports the send complete on socket error queue
+    void hold_zerocopy(size_t written_length);
+    void reap_zerocopy();
+    void release_zerocopy();
+
+    // TLS writes one record per entry, plain socket gathers entries into sendmsg
+    // File entry is sent with sendfile, or SSL_sendfile once kTLS is active
+    void write_each();
+    void write_gather();
+    void write_file();
+
     void write_all();
 
     void flush() override {
@@ -160,6 +647,9 @@ public:
         clear();
     }
 
+    // Pending writes are flushed before close
+    void drain() override;
+
     void close() override;
 
 }; // class serverpeerevent
@@ -168,9 +658,33 @@ template <bool use_ssl>
 void serverpeerevent<use_ssl>::close() {
     int last_peer_id = peer_id;
     if (last_peer_id) {
+        if (!closed && !zerocopy_holds.empty()) {
+            // Kernel still sends from held buffers, socket is kept till
+            // they are acknowledged or linger timeout
+            reap_zerocopy();
+            if (!zerocopy_holds.empty()) {
+                if (client_state != state_t::SOCKET_PEER_CLOSE) {
+                    peer_id.shutdown_write();
+                    client_state = state_t::SOCKET_PEER_CLOSE;
+                    refresh_idle_timer(config::socket_zerocopy_linger_in_ms);
+                }
+                return;
+            }
+        }
+
+        ctx.cancel_timer(idle_timer);
+        release_zerocopy();
         auto ret = peer_id.close();
         if (ret != err_t::SOCKET_RETRY) {
             log<log_t::EVENT_SERVER_CONNECTION_CLOSED>(static_cast<int>(last_peer_id));
+            if (connection_count) {
+                connection_count->fetch_sub(1, std::memory_order_relaxed);
+                connection_count.reset();
+            }
+            if (read_paused && watermark) {
+                watermark->paused_count.fetch_sub(1, std::memory_order_relaxed);
+            }
+            read_paused = false;
             client_state = state_t::SOCKET_PEER_CLOSED;
             ctx.delayed_free(this);
         } else {
@@ -179,10 +693,125 @@ void serverpeerevent<use_ssl>::close() {
     }
 }
 
+template <bool use_ssl>
+void serverpeerevent<use_ssl>::drain() {
+    switch(client_state) {
+    case state_t::SOCKET_PEER_CLOSE:
+    case state_t::SOCKET_PEER_CLOSED:
+    case state_t::SERVEREVENT_MOVED:
+        return;
+    default:
+        break;
+    }
+
+    // Called again after next execute if socket is not writable now
+    write_all();
+    if (!is_write_left()) close();
+}
+
+template <bool use_ssl>
+err_t serverpeerevent<use_ssl>::receive(size_t &read_length) {
+    read_length = 0;
+    if (!receive_buffer.reserve(config::socket_peer_read_min_free, config::socket_peer_read_max)) {
+        return err_t::SOCKET_READ_BUFFER_FULL;
+    }
+
+    auto err = peer_id.read(receive_buffer.tail(), receive_buffer.tail_size(), read_length);
+    if (err != err_t::SUCCESS) read_length = 0;
+
+    // Buffer of connection with nothing pending goes back to pool
+    receive_buffer.commit(read_length);
+    return err;
+}
+
+template <bool use_ssl>
+bool serverpeerevent<use_ssl>::can_read() {
+    // Every event reaches here, completion may be all that woke peer
+    if (!zerocopy_holds.empty()) reap_zerocopy();
+
+    const size_t queued = get_write_queued();
+    if (read_paused) {
+        if (queued > (watermark ? watermark->low : config::socket_write_low_watermark)) return false;
+
+        read_paused = false;
+        if (watermark) watermark->paused_count.fetch_sub(1, std::memory_order_relaxed);
+        log<log_t::EVENT_SERVER_READ_RESUMED>(static_cast<int>(peer_id), static_cast<uint64_t>(queued));
+        return true;
+    }
+
+    if (queued < (watermark ? watermark->high : config::socket_write_high_watermark)) return true;
+
+    read_paused = true;
+    if (watermark) {
+        watermark->paused_count.fetch_add(1, std::memory_order_relaxed);
+        watermark->pause_total.fetch_add(1, std::memory_order_relaxed);
+        auto max_queued = watermark->max_queued.load(std::memory_order_relaxed);
+        while (queued > max_queued &&
+               !watermark->max_queued.compare_exchange_weak(max_queued, queued, std::memory_order_relaxed));
+    }
+    log<log_t::EVENT_SERVER_READ_PAUSED>(static_cast<int>(peer_id), static_cast<uint64_t>(queued));
+    return false;
+}
+
+template <bool use_ssl>
+void serverpeerevent<use_ssl>::hold_zerocopy(size_t written_length) {
+    for (auto &write_buffer: write_queue) {
+        if (written_length == 0) break;
+        const size_t left = write_buffer.size - write_buffer.written;
+        if (write_buffer.io) zerocopy_holds.push_back({zerocopy_send_count, write_buffer.io->share()});
+        written_length -= std::min(written_length, left);
+    }
+    ++zerocopy_send_count;
+}
+
+template <bool use_ssl>
+void serverpeerevent<use_ssl>::reap_zerocopy() {
+    uint32_t first, last;
+    bool copied;
+    while (peer_id.read_zerocopy_completion(first, last, copied) == err_t::SUCCESS) {
+        // Send index wraps around after 2^32 sends
+        std::erase_if(zerocopy_holds, [first, last](const zerocopy_hold &hold) {
+            if (static_cast<uint32_t>(hold.send_index - first) > static_cast<uint32_t>(last - first)) return false;
+            hold.io->release();
+            return true;
+        });
+
+        if (copied && zerocopy_min_size != 0) {
+            // Route can not send in place, holding buffers only adds cost
+            zerocopy_min_size = 0;
+            log<log_t::SOCKET_ZEROCOPY_COPIED>(static_cast<int>(peer_id));
+        }
+    }
+}
+
+template <bool use_ssl>
+void serverpeerevent<use_ssl>::release_zerocopy() {
+    for (auto &hold: zerocopy_holds) hold.io->release();
+    zerocopy_holds.clear();
+}
+
 template <bool use_ssl>
 void serverpeerevent<use_ssl>::write_all() {
-    err_t err = err_t::SUCCESS;
     client_state = state_t::SOCKET_PEER_EVENT;
+    if constexpr (use_ssl) {
+        write_each();
+    } else {
+        write_gather();
+    }
+}
+
+template <bool use_ssl>
+void serverpeerevent<use_ssl>::write_each() {
+    // Small entries are copied into one TLS record, a retry after
+    // SSL_write returned want write must send same entries again.
+    // Coalesced write never exceeds one record so OpenSSL has already
+    // encrypted it and retry does not read buffer content again.
+    static thread_local uint8_t coalesce_buffer[config::socket_tls_coalesce_size];
+
+    // Header record is not sent alone in partial segment ahead of body
+    const bool corked = cork && write_queue.size() > 1;
+    if (corked) peer_id.set_cork(true);
+
     while (is_write_left()) {
         if constexpr (rohit::config::debug && use_ssl) {
             if (!peer_id.isSSLInitialized() || peer_id.is_closed()) {
@@ -191,26 +820,139 @@ void serverpeerevent<use_ssl>::write_all() {
             }
         }
 
+        if (get_write_buffer().is_file()) {
+            write_file();
+            if (client_state == state_t::SOCKET_PEER_WRITE) break;
+            continue;
+        }
+
         auto &write_buffer = get_write_buffer();
+        const uint8_t *buffer = write_buffer.buffer + write_buffer.written;
+        size_t write_size = write_buffer.size - write_buffer.written;
+        size_t entry_count = 1;
+        if (retry_entry_count != 1 && write_queue.size() > 1 && write_size < config::socket_tls_coalesce_size) {
+            uint8_t *coalesce_end = std::copy(buffer, buffer + write_size, coalesce_buffer);
+            for (auto itr = write_queue.begin() + 1; itr != write_queue.end(); ++itr) {
+                if (retry_entry_count != 0 && entry_count == retry_entry_count) break;
+                if (itr->is_file()) break;
+                const size_t size = itr->size - itr->written;
+                if (write_size + size > config::socket_tls_coalesce_size) break;
+                coalesce_end = std::copy(itr->buffer + itr->written, itr->buffer + itr->size, coalesce_end);
+                write_size += size;
+                ++entry_count;
+            }
+            buffer = coalesce_buffer;
+        }
 
         size_t written_length;
-        size_t write_size = write_buffer.size - write_buffer.written;
-        err = peer_id.write(write_buffer.buffer + write_buffer.written, write_size, written_length);
+        err_t err = peer_id.write(buffer, write_size, written_length);
+        ++flush_count;
         if (err == err_t::SUCCESS) {
             assert(written_length == write_size);
-            pop_write();
-            delete[] write_buffer.buffer;
+            retry_entry_count = 0;
+            for (size_t index = 0; index < entry_count; ++index) pop_write();
         } else if (err == err_t::SOCKET_RETRY) {
-            assert(written_length <= write_size);
-            write_buffer.written += written_length;
-            err = err_t::SUCCESS;
+            retry_entry_count = entry_count;
             client_state = state_t::SOCKET_PEER_WRITE;
             break;
         } else if (isFailure(err)) {
             log<log_t::IOT_EVENT_SERVER_WRITE_FAILED>(err);
             // Removing from write queue
+            retry_entry_count = 0;
+            for (size_t index = 0; index < entry_count; ++index) pop_write();
+        }
+    }
+
+    if (corked) peer_id.set_cork(false);
+}
+
+template <bool use_ssl>
+void serverpeerevent<use_ssl>::write_file() {
+    auto &write_buffer = get_write_buffer();
+    const size_t write_size = write_buffer.size - write_buffer.written;
+    size_t written_length = 0;
+    err_t err = peer_id.sendfile(
+                    write_buffer.file_fd,
+                    static_cast<off_t>(write_buffer.written),
+                    write_size,
+                    written_length);
+    ++flush_count;
+    if (err == err_t::SUCCESS) {
+        pop_write();
+    } else if (err == err_t::SOCKET_RETRY) {
+        write_buffer.written += written_length;
+        client_state = state_t::SOCKET_PEER_WRITE;
+    } else {
+        log<log_t::IOT_EVENT_SERVER_WRITE_FAILED>(err);
+        // Removing from write queue
+        pop_write();
+    }
+}
+
+template <bool use_ssl>
+void serverpeerevent<use_ssl>::write_gather() {
+    static_assert(config::socket_write_gather_max <= IOV_MAX, "sendmsg cannot take more than IOV_MAX entries");
+    iovec iov[config::socket_write_gather_max];
+    if (!zerocopy_holds.empty()) reap_zerocopy();
+    while (is_write_left()) {
+        if (get_write_buffer().is_file()) {
+            write_file();
+            if (client_state == state_t::SOCKET_PEER_WRITE) break;
+            continue;
+        }
+
+        // Gather stops at file entry, header is held back for body
+        // Batch with a large buffer is sent in place, small buffers in it
+        // are held along with it
+        int iovcnt = 0;
+        size_t write_size = 0;
+        bool file_next = false;
+        bool zerocopy = false;
+        for (auto &write_buffer: write_queue) {
+            if (iovcnt == config::socket_write_gather_max) break;
+            if (write_buffer.is_file()) {
+                file_next = true;
+                break;
+            }
+            iov[iovcnt].iov_base = const_cast<uint8_t *>(write_buffer.buffer + write_buffer.written);
+            iov[iovcnt].iov_len = write_buffer.size - write_buffer.written;
+            write_size += iov[iovcnt].iov_len;
+            if (zerocopy_min_size != 0 && write_buffer.io && iov[iovcnt].iov_len >= zerocopy_min_size) zerocopy = true;
+            ++iovcnt;
+        }
+
+        size_t written_length = 0;
+        err_t err = err_t::SOCKET_ZEROCOPY_NOBUFS;
+        if (zerocopy) err = peer_id.writev_zerocopy(iov, iovcnt, write_size, written_length, file_next);
+        if (err == err_t::SOCKET_ZEROCOPY_NOBUFS) {
+            zerocopy = false;
+            err = peer_id.writev(iov, iovcnt, write_size, written_length, file_next);
+        }
+        ++flush_count;
+        if (isFailure(err) && err != err_t::SOCKET_RETRY) {
+            log<log_t::IOT_EVENT_SERVER_WRITE_FAILED>(err);
+            // Removing whole batch from write queue
+            for (int index = 0; index < iovcnt; ++index) pop_write();
+            continue;
+        }
+
+        if (zerocopy && written_length != 0) hold_zerocopy(written_length);
+
+        // Partial write may end in the middle of any entry
+        while (written_length) {
+            auto &write_buffer = get_write_buffer();
+            const size_t left = write_buffer.size - write_buffer.written;
+            if (written_length < left) {
+                write_buffer.written += written_length;
+                break;
+            }
+            written_length -= left;
             pop_write();
-            delete[] write_buffer.buffer;
+        }
+
+        if (err == err_t::SOCKET_RETRY) {
+            client_state = state_t::SOCKET_PEER_WRITE;
+            break;
         }
     }
 }
@@ -18,9 +18,16 @@
 #include <iot/core/math.hh>
 #include <iot/core/ipv6addr.hh>
 #include <iot/core/log.hh>
+#include <linux/errqueue.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
 #include <arpa/inet.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
+#include <chrono>
 #include <string>
 #include <cstring>
 #include <filesystem>
@@ -40,6 +47,26 @@ constexpr ipv6_socket_addr_t::operator sockaddr_in6() const {
     return sockaddr;
 }
 
+inline const ipv6_socket_addr_t to_ipv6_socket_addr_t(const sockaddr_in6 &addr) {
+    const ipv6_port_t &port = *reinterpret_cast<const ipv6_port_t *>(&addr.sin6_port);
+    return ipv6_socket_addr_t(&addr.sin6_addr.__in6_u, port);
+}
+
+// TCP options of a listener, accepted sockets inherit all but defer
+// accept from listening socket. 0 or false keeps kernel default.
+struct tcp_profile {
+    bool nodelay { false };
+    bool cork { false };                // Header and body of TLS response leave in full segments
+    int defer_accept_in_s { 0 };        // Accept is woken only once request data arrives
+    int keepalive_idle_in_s { 0 };      // Keepalive is enabled if idle is set
+    int keepalive_interval_in_s { 0 };
+    int keepalive_count { 0 };
+    int user_timeout_in_ms { 0 };       // Connection with unacknowledged data is dropped after it
+    int notsent_lowat { 0 };            // Writable only below these many unsent bytes
+    int receive_buffer_size { 0 };      // Kernel clamps to net.core.rmem_max
+    int send_buffer_size { 0 };         // Kernel clamps to net.core.wmem_max
+};
+
 inline int create_socket() {
     int socket_id = socket(AF_INET6, SOCK_STREAM, IPPROTO_TCP);
     if (socket_id < 0) {
@@ -84,33 +111,34 @@ public:
         return err_t::SUCCESS;
     }
 
-        inline err_t write_wait(
+    // Blocks calling thread till socket is ready, only for client side code.
+    // Loop thread must queue write and continue on EPOLLOUT instead.
+    inline err_t write_wait(
                 const void *buf,
                 const size_t send_len,
                 size_t &actual_sent,
-                int64_t wait_in_millisecond = config::attempt_to_write_wait_in_ms,
-                int write_attempt = config::attempt_to_write) const {
-        int attempt_to_write = 0;
-        while(attempt_to_write < write_attempt) {
+                const int64_t timeout_in_ms = config::socket_wait_timeout_in_ms) const {
+        // Write of nothing returns 0 and socket stays writable, it would spin till deadline
+        if (send_len == 0) {
+            actual_sent = 0;
+            return err_t::SUCCESS;
+        }
+        const auto deadline = wait_deadline(timeout_in_ms);
+        while(true) {
             int ret = ::write(socket_id, buf, send_len);
             if (ret > 0) {
                 actual_sent = ret;
-                break;
+                return err_t::SUCCESS;
             }
 
-            if (ret < 0) {
+            if (ret < 0 && errno != EAGAIN && errno != EINTR) {
                 return err_t::SEND_FAILURE;
             }
-            
-            ++attempt_to_write;
-            std::this_thread::sleep_for(std::chrono::milliseconds(wait_in_millisecond));
-        }
 
-        if (attempt_to_write == write_attempt) {
-            return err_t::SOCKET_WRITE_ZERO;
+            if (!wait_ready(POLLOUT, deadline)) {
+                return err_t::SOCKET_WAIT_TIMEOUT;
+            }
         }
-
-        return err_t::SUCCESS;
     }
 
     inline err_t write(const void *buf, const size_t send_len, size_t &actual_sent) const {
@@ -126,6 +154,101 @@ public:
         return err_t::SUCCESS;
     }
 
+    // Gathered write, actual_sent may end in the middle of any entry
+    // more holds back partial segment as caller is about to send rest
+    inline err_t writev(
+                const iovec *iov,
+                const int iovcnt,
+                const size_t send_len,
+                size_t &actual_sent,
+                const bool more = false) const {
+        msghdr msg { };
+        msg.msg_iov = const_cast<iovec *>(iov);
+        msg.msg_iovlen = iovcnt;
+        ssize_t ret = ::sendmsg(socket_id, &msg, MSG_NOSIGNAL | (more ? MSG_MORE : 0));
+        if (ret == -1) {
+            actual_sent = 0;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return err_t::SOCKET_RETRY;
+            return err_t::SEND_FAILURE;
+        }
+        actual_sent = ret;
+        if (actual_sent < send_len) {
+            return err_t::SOCKET_RETRY;
+        }
+        return err_t::SUCCESS;
+    }
+
+    // Same as writev but kernel sends from buffers in place. Buffers must
+    // not change till read_zerocopy_completion reports this send. Sends are
+    // numbered from 0 by kernel, every call that sends any byte takes one.
+    inline err_t writev_zerocopy(
+                const iovec *iov,
+                const int iovcnt,
+                const size_t send_len,
+                size_t &actual_sent,
+                const bool more = false) const {
+        msghdr msg { };
+        msg.msg_iov = const_cast<iovec *>(iov);
+        msg.msg_iovlen = iovcnt;
+        ssize_t ret = ::sendmsg(socket_id, &msg, MSG_NOSIGNAL | MSG_ZEROCOPY | (more ? MSG_MORE : 0));
+        if (ret == -1) {
+            actual_sent = 0;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return err_t::SOCKET_RETRY;
+            if (errno == ENOBUFS) return err_t::SOCKET_ZEROCOPY_NOBUFS;
+            return err_t::SEND_FAILURE;
+        }
+        actual_sent = ret;
+        if (actual_sent < send_len) {
+            return err_t::SOCKET_RETRY;
+        }
+        return err_t::SUCCESS;
+    }
+
+    // Range of zerocopy sends kernel is done with, SOCKET_RETRY once error
+    // queue has nothing more. copied is set when kernel copied data anyway.
+    inline err_t read_zerocopy_completion(uint32_t &first, uint32_t &last, bool &copied) const {
+        while(true) {
+            uint8_t control[CMSG_SPACE(sizeof(sock_extended_err) + sizeof(sockaddr_in6))];
+            msghdr msg { };
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+            if (::recvmsg(socket_id, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) == -1) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) return err_t::SOCKET_RETRY;
+                return err_t::RECEIVE_FAILURE;
+            }
+
+            for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+                if (!(cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) &&
+                    !(cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)) continue;
+                const auto *serr = reinterpret_cast<const sock_extended_err *>(CMSG_DATA(cmsg));
+                if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) continue;
+                first = serr->ee_info;
+                last = serr->ee_data;
+                copied = (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0;
+                return err_t::SUCCESS;
+            }
+            // Other errors in queue are not for zerocopy, they are skipped
+        }
+    }
+
+    // Plain socket can always send file entries
+    constexpr bool can_sendfile() const { return true; }
+
+    // Kernel copies from page cache of file_fd, offset of file_fd is not changed
+    inline err_t sendfile(const int file_fd, off_t offset, const size_t send_len, size_t &actual_sent) const {
+        ssize_t ret = ::sendfile(socket_id, file_fd, &offset, send_len);
+        if (ret == -1) {
+            actual_sent = 0;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return err_t::SOCKET_RETRY;
+            return err_t::SEND_FAILURE;
+        }
+        actual_sent = ret;
+        if (actual_sent < send_len) {
+            return err_t::SOCKET_RETRY;
+        }
+        return err_t::SUCCESS;
+    }
+
     constexpr err_t accept() {
         return err_t::SUCCESS;
     }
@@ -134,18 +257,14 @@ public:
         sockaddr_in6 addr;
         socklen_t len = sizeof(addr);
         getpeername(socket_id, reinterpret_cast<struct sockaddr *>(&addr), &len);
-
-        ipv6_port_t &port = *reinterpret_cast<ipv6_port_t *>(&addr.sin6_port);
-        return ipv6_socket_addr_t(&addr.sin6_addr.__in6_u, port);
+        return to_ipv6_socket_addr_t(addr);
     }
 
     inline const ipv6_socket_addr_t get_local_ipv6_addr() const {
         sockaddr_in6 addr;
         socklen_t len = sizeof(addr);
         getsockname(socket_id, (struct sockaddr *)&addr, &len);
-
-        ipv6_port_t &port = *reinterpret_cast<ipv6_port_t *>(&addr.sin6_port);
-        return ipv6_socket_addr_t(&addr.sin6_addr.__in6_u, port);
+        return to_ipv6_socket_addr_t(addr);
     }
 
     // Returns local or socket IP address
@@ -165,7 +284,102 @@ public:
         return flags != -1;
     }
 
+    // Busy polls device queue for busy_poll_in_us on blocking read and poll
+    // Raising it above net.core.busy_read requires CAP_NET_ADMIN
+    // Accepted sockets inherit it from listener
+    inline bool set_busy_poll(const int busy_poll_in_us) {
+        const int prefer = busy_poll_in_us > 0 ? 1 : 0;
+        if (setsockopt(socket_id, SOL_SOCKET, SO_BUSY_POLL, &busy_poll_in_us, sizeof(busy_poll_in_us)) < 0) {
+            return false;
+        }
+        // Not supported before Linux 5.11, busy poll still works without it
+        setsockopt(socket_id, SOL_SOCKET, SO_PREFER_BUSY_POLL, &prefer, sizeof(prefer));
+        return true;
+    }
+
+    // Every option is attempted, false if any of them failed
+    inline bool set_tcp_profile(const tcp_profile &profile) {
+        bool success = true;
+        const int enable = 1;
+        if (profile.nodelay) success &= set_option(IPPROTO_TCP, TCP_NODELAY, enable);
+        if (profile.defer_accept_in_s > 0) success &= set_option(IPPROTO_TCP, TCP_DEFER_ACCEPT, profile.defer_accept_in_s);
+        if (profile.keepalive_idle_in_s > 0) {
+            success &= set_option(SOL_SOCKET, SO_KEEPALIVE, enable);
+            success &= set_option(IPPROTO_TCP, TCP_KEEPIDLE, profile.keepalive_idle_in_s);
+            if (profile.keepalive_interval_in_s > 0) success &= set_option(IPPROTO_TCP, TCP_KEEPINTVL, profile.keepalive_interval_in_s);
+            if (profile.keepalive_count > 0) success &= set_option(IPPROTO_TCP, TCP_KEEPCNT, profile.keepalive_count);
+        }
+        if (profile.user_timeout_in_ms > 0) success &= set_option(IPPROTO_TCP, TCP_USER_TIMEOUT, profile.user_timeout_in_ms);
+        if (profile.notsent_lowat > 0) success &= set_option(IPPROTO_TCP, TCP_NOTSENT_LOWAT, profile.notsent_lowat);
+        if (profile.receive_buffer_size > 0) success &= set_option(SOL_SOCKET, SO_RCVBUF, profile.receive_buffer_size);
+        if (profile.send_buffer_size > 0) success &= set_option(SOL_SOCKET, SO_SNDBUF, profile.send_buffer_size);
+        return success;
+    }
+
+    // Kernel reports double of what was set, half of it is usable payload
+    inline int get_receive_buffer_size() const { return get_option(SOL_SOCKET, SO_RCVBUF) / 2; }
+    inline int get_send_buffer_size() const { return get_option(SOL_SOCKET, SO_SNDBUF) / 2; }
+
+    // Partial segments are held till uncork, pending data is sent on uncork
+    inline void set_cork(const bool cork) { set_option(IPPROTO_TCP, TCP_CORK, cork ? 1 : 0); }
+
+    inline bool set_option(const int level, const int option, const int value) {
+        return setsockopt(socket_id, level, option, &value, sizeof(value)) == 0;
+    }
+
+    inline int get_option(const int level, const int option) const {
+        int value = 0;
+        socklen_t value_size = sizeof(value);
+        if (getsockopt(socket_id, level, option, &value, &value_size) < 0) return 0;
+        return value;
+    }
+
+    // Needed before writev_zerocopy, false where socket does not support it
+    inline bool set_zerocopy() {
+        const int enable = 1;
+        return setsockopt(socket_id, SOL_SOCKET, SO_ZEROCOPY, &enable, sizeof(enable)) == 0;
+    }
+
+    // Peer gets FIN after data already queued, socket stays open
+    inline void shutdown_write() const { ::shutdown(socket_id, SHUT_WR); }
+
+protected:
+    static inline std::chrono::steady_clock::time_point wait_deadline(const int64_t timeout_in_ms) {
+        return std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_in_ms);
+    }
+
+    // Returns once socket has any of events, error or hangup is reported as
+    // ready so that next operation returns it. False once deadline is past.
+    inline bool wait_ready(const short events, const std::chrono::steady_clock::time_point deadline) const {
+        while(true) {
+            const auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+            if (left <= 0) return false;
+            pollfd pfd { socket_id, events, 0 };
+            const int ret = ::poll(&pfd, 1, static_cast<int>(left));
+            if (ret > 0) return true;
+            if (ret == 0 || errno != EINTR) return false;
+        }
+    }
+
+public:
+
     inline bool is_closed() const { return socket_id == 0; }
+
+    // Connection rejected right after accept, nothing to shutdown
+    inline err_t discard() { return close(); }
+
+    // Close with unread input sends RST and peer may drop reply queued
+    // before it, input already received is read and dropped after FIN
+    inline err_t discard_after_reply() {
+        shutdown_write();
+        uint8_t buffer[1024];
+        for(size_t drained = 0; drained < config::socket_reject_drain_size; ) {
+            const auto ret = ::recv(socket_id, buffer, sizeof(buffer), MSG_DONTWAIT);
+            if (ret <= 0) break;
+            drained += static_cast<size_t>(ret);
+        }
+        return close();
+    }
 };
 
 inline std::ostream& operator<<(std::ostream& os, const socket_t &client_id) {
@@ -225,18 +439,22 @@ public:
         return err_t::SUCCESS;
     }
 
+    // Client side only, TLS may need to write during read for renegotiation
     inline err_t read_wait(
                 void *buf,
                 const size_t buf_size,
                 size_t &read_len,
-                int64_t wait_in_millisecond = config::attempt_to_write_wait_in_ms,
-                int write_attempt = config::attempt_to_write) const {
-        int attempt_to_write = 0;
-        while(attempt_to_write < write_attempt) {
+                const int64_t timeout_in_ms = config::socket_wait_timeout_in_ms) const {
+        if (buf_size == 0) {
+            read_len = 0;
+            return err_t::SUCCESS;
+        }
+        const auto deadline = wait_deadline(timeout_in_ms);
+        while(true) {
             int ret = SSL_read(ssl, buf, buf_size);
             if (ret > 0) {
                 read_len = ret;
-                break;
+                return err_t::SUCCESS;
             }
 
             auto ssl_error = SSL_get_error(ssl, ret);
@@ -245,17 +463,12 @@ public:
                 read_len = 0;
                 return error_c::ssl_error_ret(ssl_error);
             }
-            
-            ++attempt_to_write;
-            std::this_thread::sleep_for(std::chrono::milliseconds(wait_in_millisecond));
-        }
 
-        if (attempt_to_write == write_attempt) {
-            read_len = 0;
-            return err_t::SOCKET_WRITE_ZERO;
+            if (!wait_ready(ssl_error == SSL_ERROR_WANT_READ ? POLLIN : POLLOUT, deadline)) {
+                read_len = 0;
+                return err_t::SOCKET_WAIT_TIMEOUT;
+            }
         }
-
-        return err_t::SUCCESS;
     }
 
     inline err_t read(void *buf, const size_t buf_size, size_t &read_len) const {
@@ -268,18 +481,22 @@ public:
         return err_t::SUCCESS;
     }
 
+    // Client side only, retry after timeout must pass same buffer again
     inline err_t write_wait(
                 const void *buf,
                 const size_t send_len,
                 size_t &actual_sent,
-                int64_t wait_in_millisecond = config::attempt_to_write_wait_in_ms,
-                int write_attempt = config::attempt_to_write) const {
-        int attempt_to_write = 0;
-        while(attempt_to_write < write_attempt) {
+                const int64_t timeout_in_ms = config::socket_wait_timeout_in_ms) const {
+        if (send_len == 0) {
+            actual_sent = 0;
+            return err_t::SUCCESS;
+        }
+        const auto deadline = wait_deadline(timeout_in_ms);
+        while(true) {
             int ret = SSL_write(ssl, buf, send_len);
             if (ret > 0) {
                 actual_sent = ret;
-                break;
+                return err_t::SUCCESS;
             }
 
             auto ssl_error = SSL_get_error(ssl, ret);
@@ -287,16 +504,11 @@ public:
             if (ssl_error != SSL_ERROR_WANT_WRITE && ssl_error != SSL_ERROR_WANT_READ) {
                 return error_c::ssl_error_ret(ssl_error);
             }
-            
-            ++attempt_to_write;
-            std::this_thread::sleep_for(std::chrono::milliseconds(wait_in_millisecond));
-        }
 
-        if (attempt_to_write == write_attempt) {
-            return err_t::SOCKET_WRITE_ZERO;
+            if (!wait_ready(ssl_error == SSL_ERROR_WANT_READ ? POLLIN : POLLOUT, deadline)) {
+                return err_t::SOCKET_WAIT_TIMEOUT;
+            }
         }
-
-        return err_t::SUCCESS;
     }
 
     inline err_t write(const void *buf, const size_t send_len, size_t &actual_sent) const {
@@ -312,6 +524,37 @@ public:
         return err_t::SUCCESS;
     }
 
+    // True once handshake has moved record encryption to kernel,
+    // false when kernel or cipher does not support it
+    inline bool can_sendfile() const {
+#ifndef OPENSSL_NO_KTLS
+        return ssl != nullptr && BIO_get_ktls_send(SSL_get_wbio(ssl));
+#else
+        return false;
+#endif
+    }
+
+    // Only valid when can_sendfile(), kernel encrypts directly from page cache
+    inline err_t sendfile(const int file_fd, off_t offset, const size_t send_len, size_t &actual_sent) const {
+#ifndef OPENSSL_NO_KTLS
+        auto ret = SSL_sendfile(ssl, file_fd, offset, send_len, 0);
+        if (ret <= 0) {
+            actual_sent = 0;
+            auto ssl_error = SSL_get_error(ssl, static_cast<int>(ret));
+            return error_c::ssl_error_ret(ssl_error);
+        }
+        actual_sent = ret;
+        if (actual_sent < send_len) {
+            return err_t::SOCKET_RETRY;
+        }
+        return err_t::SUCCESS;
+#else
+        (void)file_fd; (void)offset; (void)send_len;
+        actual_sent = 0;
+        return err_t::SEND_FAILURE;
+#endif
+    }
+
     inline void get_protocol(const uint8_t *&data, size_t &len) {
         unsigned int _len;
         SSL_get0_alpn_selected(ssl, &data, &_len);
@@ -339,17 +582,31 @@ public:
 
     inline bool isSSLInitialized() const { return ssl != nullptr; };
 
+    // Connection rejected right after accept, handshake never started
+    inline err_t discard() {
+        SSL_free(ssl);
+        ssl = nullptr;
+        return socket_t::close();
+    }
+
 };
 
 class server_socket_t : public socket_t {
 public:
-    inline server_socket_t(const int port) {
+    // reuseport allows multiple listener on same port, kernel distributes
+    // connections among them. This is used by sharded event distributor
+    inline server_socket_t(const int port, const bool reuseport = false) {
         int enable = 1;
         if (setsockopt(socket_id, SOL_SOCKET, SO_REUSEADDR, (char *)&enable,sizeof(enable)) < 0) {
             close(); 
             throw exception_t(error_c::sockopt_ret());
         }
 
+        if (reuseport && setsockopt(socket_id, SOL_SOCKET, SO_REUSEPORT, (char *)&enable,sizeof(enable)) < 0) {
+            close(); 
+            throw exception_t(error_c::sockopt_ret());
+        }
+
         struct sockaddr_in6 addr;
         memset(&addr, 0, sizeof(addr));
         addr.sin6_family = AF_INET6;
@@ -371,8 +628,31 @@ public:
 
     inline operator int() const { return socket_id; }
 
-    inline socket_t accept() {
-        auto client_id = ::accept(socket_id, NULL, NULL);
+    // Listen again on listening socket only changes its backlog
+    inline bool set_backlog(const int backlog) { return ::listen(socket_id, backlog) == 0; }
+
+    inline socket_t accept() { return accept(socket_id); }
+
+    // listen_id is a listener on same port, created with reuseport
+    inline socket_t accept(const int listen_id) {
+        auto client_id = ::accept(listen_id, NULL, NULL);
+        if (client_id == -1) {
+            if (errno == EAGAIN) {
+                return 0;
+            }
+            throw exception_t(err_t::ACCEPT_FAILURE);
+        }
+
+        log<log_t::SOCKET_ACCEPT_SUCCESS>(listen_id, client_id);
+        return client_id;
+    }
+
+    // Accepted socket is already non blocking and close on exec,
+    // peer address is returned by accept itself
+    inline socket_t accept(const int listen_id, ipv6_socket_addr_t &peer_addr) {
+        sockaddr_in6 addr;
+        socklen_t len = sizeof(addr);
+        auto client_id = ::accept4(listen_id, reinterpret_cast<struct sockaddr *>(&addr), &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
         if (client_id == -1) {
             if (errno == EAGAIN) {
                 return 0;
@@ -380,17 +660,33 @@ public:
             throw exception_t(err_t::ACCEPT_FAILURE);
         }
 
-        log<log_t::SOCKET_ACCEPT_SUCCESS>(socket_id, client_id);
+        peer_addr = to_ipv6_socket_addr_t(addr);
+        log<log_t::SOCKET_ACCEPT_SUCCESS>(listen_id, client_id);
         return client_id;
     }
 
 };
 
 class server_socket_ssl_t : public server_socket_t {
+private:
+    // Set on every accepted SSL, OpenSSL falls back to userspace
+    // when kernel has no tls module or cipher is not supported
+    bool ktls { false };
+
+    inline SSL *create_ssl(const int client_id) const {
+        auto ssl = SSL_new(socket_ssl_t::ctx);
+        SSL_set_fd(ssl, client_id);
+        if (ktls) SSL_set_options(ssl, SSL_OP_ENABLE_KTLS);
+        return ssl;
+    }
 
 public:
-    inline server_socket_ssl_t(const int port, const char *const cert_file, const char *const prikey_file)
-            : server_socket_t(port) {
+    inline server_socket_ssl_t(
+                const int port,
+                const char *const cert_file,
+                const char *const prikey_file,
+                const bool reuseport = false)
+            : server_socket_t(port, reuseport) {
         auto ctx = socket_ssl_t::ctx;
         socket_ssl_t::init_openssl(false);
 
@@ -424,8 +720,21 @@ public:
         socket_ssl_t::cleanup_openssl();
     }
 
-    inline socket_ssl_t accept() {
-        auto client_id = ::accept(socket_id, NULL, NULL);
+    inline void set_ktls(const bool ktls) {
+#ifndef OPENSSL_NO_KTLS
+        this->ktls = ktls;
+#else
+        if (ktls) log<log_t::SOCKET_SSL_KTLS_UNAVAILABLE>(socket_id);
+#endif
+    }
+
+    constexpr bool is_ktls() const { return ktls; }
+
+    inline socket_ssl_t accept() { return accept(socket_id); }
+
+    // listen_id is a listener on same port, created with reuseport
+    inline socket_ssl_t accept(const int listen_id) {
+        auto client_id = ::accept(listen_id, NULL, NULL);
         if (client_id == -1) {
             if (errno == EAGAIN) {
                 return {0, nullptr};
@@ -433,10 +742,29 @@ public:
             throw exception_t(err_t::ACCEPT_FAILURE);
         }
 
-        auto ssl = SSL_new(socket_ssl_t::ctx);
-        SSL_set_fd(ssl, client_id);
+        auto ssl = create_ssl(client_id);
+
+        log<log_t::SOCKET_ACCEPT_SUCCESS>(listen_id, client_id);
+        return {client_id, ssl};
+    }
+
+    // Accepted socket is already non blocking and close on exec,
+    // peer address is returned by accept itself
+    inline socket_ssl_t accept(const int listen_id, ipv6_socket_addr_t &peer_addr) {
+        sockaddr_in6 addr;
+        socklen_t len = sizeof(addr);
+        auto client_id = ::accept4(listen_id, reinterpret_cast<struct sockaddr *>(&addr), &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_id == -1) {
+            if (errno == EAGAIN) {
+                return {0, nullptr};
+            }
+            throw exception_t(err_t::ACCEPT_FAILURE);
+        }
+
+        auto ssl = create_ssl(client_id);
 
-        log<log_t::SOCKET_ACCEPT_SUCCESS>(socket_id, client_id);
+        peer_addr = to_ipv6_socket_addr_t(addr);
+        log<log_t::SOCKET_ACCEPT_SUCCESS>(listen_id, client_id);
         return {client_id, ssl};
     }
 
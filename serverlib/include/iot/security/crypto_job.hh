@@ -0,0 +1,82 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <iot/security/crypto.hh>
+#include <iot/states/compute_pool.hh>
+
+namespace rohit {
+namespace crypto {
+
+// Crypto work for compute pool, submit with ctx.submit_job(owner, job).
+// Inputs are referenced and must outlive job, result is read by owner
+// executor on its own loop thread once is_done.
+
+class key_derivation_job : public compute_job {
+private:
+    const openssl_ec_key_mem &private_ec_key;
+    const mem<void> peer_public_ec_key;
+    key_aes_256_gsm_t key { };
+    err_t result { err_t::GENERAL_FAILURE };
+
+public:
+    inline key_derivation_job(const openssl_ec_key_mem &private_ec_key, const mem<void> &peer_public_ec_key)
+        : compute_job(compute_kind_t::KEY_DERIVATION), private_ec_key(private_ec_key), peer_public_ec_key(peer_public_ec_key) { }
+
+    void run() override {
+        result = get_symmetric_key_from_ec(encryption_id_t::aes_256_gsm, private_ec_key, peer_public_ec_key, key);
+    }
+
+    constexpr err_t get_result() const { return result; }
+    constexpr const key_aes_256_gsm_t &get_key() const { return key; }
+};
+
+class encrypt_job : public compute_job {
+private:
+    const key_t &key;
+    const guid_t random;
+    const mem<void> data;
+    openssl_mem encrypted_data { };
+    err_t result { err_t::GENERAL_FAILURE };
+
+public:
+    inline encrypt_job(const key_t &key, const guid_t &random, const mem<void> &data)
+        : compute_job(compute_kind_t::ENCRYPTION), key(key), random(random), data(data) { }
+
+    void run() override { result = encrypt(key, random, data, encrypted_data); }
+
+    constexpr err_t get_result() const { return result; }
+    constexpr openssl_mem &get_encrypted_data() { return encrypted_data; }
+};
+
+class decrypt_job : public compute_job {
+private:
+    const key_t &key;
+    const mem<void> encrypted_data;
+    openssl_mem decrypted_data { };
+    err_t result { err_t::GENERAL_FAILURE };
+
+public:
+    inline decrypt_job(const key_t &key, const mem<void> &encrypted_data)
+        : compute_job(compute_kind_t::ENCRYPTION), key(key), encrypted_data(encrypted_data) { }
+
+    void run() override { result = decrypt(key, encrypted_data, decrypted_data); }
+
+    constexpr err_t get_result() const { return result; }
+    constexpr openssl_mem &get_decrypted_data() { return decrypted_data; }
+};
+
+} // namespace crypto
+} // namespace rohit
@@ -0,0 +1,163 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <iot/states/event_distributor.hh>
+#include <iot/core/pthread_helper.hh>
+#include <pthread.h>
+#include <atomic>
+#include <deque>
+#include <memory>
+
+namespace rohit {
+
+#define COMPUTE_KIND_LIST \
+    COMPUTE_KIND_ENTRY(KEY_DERIVATION) \
+    COMPUTE_KIND_ENTRY(ENCRYPTION) \
+    COMPUTE_KIND_ENTRY(COMPRESSION) \
+    COMPUTE_KIND_ENTRY(OTHER) \
+    LIST_DEFINITION_END
+
+// Latency is accounted separately for each kind
+enum class compute_kind_t {
+#define COMPUTE_KIND_ENTRY(x) x,
+    COMPUTE_KIND_LIST
+#undef COMPUTE_KIND_ENTRY
+    MAX_KIND
+};
+
+class compute_pool;
+
+// CPU heavy work run on compute thread. Job is owned by submitter and
+// must not be freed before is_done. Owner executor is executed again on
+// its loop thread once job is done, execute checks is_done for result.
+class compute_job {
+private:
+    const compute_kind_t kind;
+    event_executor *owner { nullptr };
+    uint64_t submit_ns { 0 };
+    uint64_t start_ns { 0 };
+    uint64_t finish_ns { 0 };
+    std::atomic<bool> done { false };
+
+    friend class compute_pool;
+    friend class event_distributor;
+
+public:
+    inline compute_job(const compute_kind_t kind) : kind(kind) { }
+    virtual ~compute_job() = default;
+
+    // Runs on compute thread, must not touch owner
+    virtual void run() = 0;
+
+    inline bool is_done() const { return done.load(std::memory_order_acquire); }
+    constexpr compute_kind_t get_kind() const { return kind; }
+
+    // Valid after is_done
+    constexpr uint64_t get_queue_ns() const { return start_ns - submit_ns; }
+    constexpr uint64_t get_run_ns() const { return finish_ns - start_ns; }
+};
+
+template <typename FUNC>
+class compute_job_function : public compute_job {
+private:
+    FUNC function;
+
+public:
+    template <typename ARG>
+    inline compute_job_function(const compute_kind_t kind, ARG &&function)
+        : compute_job(kind), function(std::forward<ARG>(function)) { }
+    void run() override { function(); }
+};
+
+struct compute_stats {
+    uint64_t job_count;
+    uint64_t queue_ns;
+    uint64_t run_ns;
+    uint64_t max_run_ns;
+};
+
+// Every compute thread has its own deque, submitter pushes to deque of
+// thread mapped to its loop thread. Idle compute thread takes oldest job
+// of its own deque first and then steals newest job of other threads.
+class compute_pool {
+public:
+    static constexpr size_t max_thread_supported = 64;
+
+private:
+    struct alignas(64) worker_entry : public pthread_lock_c<true> {
+        std::deque<compute_job *> jobs { };
+        compute_pool *pool { nullptr };
+        size_t index { 0 };
+        pthread_t pthread { };
+    };
+
+    struct alignas(64) kind_stats {
+        std::atomic<uint64_t> job_count { 0 };
+        std::atomic<uint64_t> queue_ns { 0 };
+        std::atomic<uint64_t> run_ns { 0 };
+        std::atomic<uint64_t> max_run_ns { 0 };
+
+        // Last values reported, used only by log_stats
+        uint64_t reported_job_count { 0 };
+        uint64_t reported_queue_ns { 0 };
+        uint64_t reported_run_ns { 0 };
+    };
+
+    event_distributor &evtdist;
+    size_t thread_count;
+    std::unique_ptr<worker_entry[]> workers;
+    size_t started_thread_count { 0 };
+    kind_stats stats[static_cast<size_t>(compute_kind_t::MAX_KIND)];
+
+    // Jobs pushed and not yet taken
+    alignas(64) std::atomic<size_t> pending_count { 0 };
+    std::atomic<size_t> next_worker { 0 };
+    std::atomic<bool> is_stopping { false };
+
+    // Submit takes idle_lock only when some thread waits on idle_cond
+    alignas(64) std::atomic<size_t> idle_count { 0 };
+    pthread_mutex_t idle_lock;
+    pthread_cond_t idle_cond;
+
+    static void *loop(void *pworker);
+    compute_job *take(const size_t index);
+    void run_job(compute_job *job);
+
+public:
+    compute_pool(event_distributor &evtdist, const size_t thread_count);
+    ~compute_pool();
+
+    compute_pool(const compute_pool &) = delete;
+    compute_pool &operator=(const compute_pool &) = delete;
+
+    void init();
+
+    // Owner is held till its completion execute is done
+    void submit(event_executor *owner, compute_job *job);
+
+    // Threads finish queued jobs and exit, join waits for them
+    void stop();
+    void join();
+
+    constexpr size_t get_thread_count() const { return thread_count; }
+    inline size_t get_pending_count() const { return pending_count.load(std::memory_order_relaxed); }
+    compute_stats get_stats(const compute_kind_t kind) const;
+
+    // Called by cleanup thread, logs jobs since last call
+    void log_stats();
+}; // class compute_pool
+
+} // namespace rohit
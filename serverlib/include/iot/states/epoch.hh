@@ -0,0 +1,89 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace rohit {
+
+class event_executor;
+
+// Epoch based reclamation of event_executor.
+// Every loop thread announces global epoch once per loop iteration before
+// waiting for events, so pointers it receives from epoll belong to that epoch.
+// Executor retired in epoch e is freed once global epoch reaches e + 2,
+// at that point every loop thread has finished the iteration it could have
+// seen the executor in. Global epoch moves only when all the loop threads
+// have announced it, no lock is taken on any path.
+class epoch_manager {
+public:
+    static constexpr size_t bucket_count = 3;
+    static constexpr uint64_t inactive_epoch = UINT64_MAX;
+
+private:
+    struct bucket {
+        uint64_t epoch { 0 };
+        event_executor *head { nullptr };
+        size_t count { 0 };
+    };
+
+    // Written only by owner loop thread except local_epoch that is read by all
+    struct alignas(64) thread_entry {
+        std::atomic<uint64_t> local_epoch { inactive_epoch };
+        bucket buckets[bucket_count];
+    };
+
+    alignas(64) std::atomic<uint64_t> global_epoch { 0 };
+
+    // Executors retired by thread other than loop thread, adopted by loop threads
+    alignas(64) std::atomic<event_executor *> orphan_head { nullptr };
+
+    // Retired and not yet freed, loop threads bound their wait while this is non zero
+    alignas(64) std::atomic<int64_t> pending_count { 0 };
+
+    const size_t thread_count;
+    std::unique_ptr<thread_entry[]> entries;
+
+    void free_list(event_executor *head);
+    void free_bucket(bucket &retired_bucket);
+    void push_local(thread_entry &entry, event_executor *head, event_executor *tail, const size_t count);
+    void try_advance();
+
+public:
+    epoch_manager(const size_t thread_count);
+    ~epoch_manager();
+
+    epoch_manager(const epoch_manager &) = delete;
+    epoch_manager &operator=(const epoch_manager &) = delete;
+
+    // Only from loop thread thread_index
+    void retire(const size_t thread_index, event_executor *executor);
+
+    // From any thread
+    void retire_orphan(event_executor *executor);
+
+    // Called by loop thread once per iteration before waiting
+    // announces epoch, adopts orphans, frees what is safe and tries to advance epoch
+    void quiescent(const size_t thread_index);
+
+    // Ordered with idle count of loop threads, see event_distributor::enter_idle
+    inline bool has_pending() const { return pending_count.load(std::memory_order_seq_cst) != 0; }
+    inline uint64_t get_epoch() const { return global_epoch.load(std::memory_order_relaxed); }
+};
+
+} // namespace rohit
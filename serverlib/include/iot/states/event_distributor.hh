@@ -17,21 +17,69 @@
 #include <iot/states/statesentry.hh>
 #include <iot/core/error.hh>
 #include <iot/core/log.hh>
-#include <unordered_map>
+#include <iot/core/cpu_topology.hh>
+#include <iot/core/clock.hh>
+#include <iot/core/latency_histogram.hh>
+#include <iot/states/timer_wheel.hh>
+#include <iot/states/epoch.hh>
+#include <iot/core/pthread_helper.hh>
 #include <sys/epoll.h>
-#include <queue>
-#include <unordered_set>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <algorithm>
+#include <concepts>
+#include <typeinfo>
+#include <vector>
 
 namespace rohit {
 
 class thread_context;
 extern thread_local thread_context ctx;
 
+class compute_job;
+class compute_pool;
+
 class event_executor {
 protected:
     std::atomic<int> executor_count{ 0 };
     bool closed{ false };
 
+    // Socket error queue carries notifications such as zerocopy completion,
+    // EPOLLERR without hangup is executed instead of closing
+    bool error_queue{ false };
+
+    // Loop thread that served this executor spins this long before blocking
+    uint16_t busy_poll_in_us{ 0 };
+
+private:
+    // Set once executor is handed to delayed_free
+    std::atomic<bool> retired{ false };
+    event_executor *retire_next{ nullptr };
+
+    // Compute jobs in flight, executor handed to delayed_free while held
+    // is retired when last hold is released
+    static constexpr uint32_t hold_retired = 0x80000000U;
+    std::atomic<uint32_t> holds{ 0 };
+
+    // Shard this executor was added to, tasks posted to owner run there
+    size_t owner_shard{ 0 };
+
+    // Set while executor waits in ready list of a loop thread
+    std::atomic<bool> ready_queued{ false };
+
+    // Set by event_distributor::drain, served by thread holding executor
+    std::atomic<bool> drain_requested{ false };
+    bool draining{ false };
+
+    // Links in drain list of tracked_shard, guarded by list lock
+    std::atomic<bool> tracked{ false };
+    size_t tracked_shard{ 0 };
+    event_executor *tracked_prev{ nullptr };
+    event_executor *tracked_next{ nullptr };
+
+protected:
+
     // This is pure virtual function can be called only from event_distributor
     // event is irreralevent as in our case we are following
     // no read till all write is done and compulsory read after write
@@ -44,11 +92,31 @@ protected:
     virtual void close() = 0;
     virtual void flush() = 0;
 
+    // Called when timer armed by this executor expires
+    // this is called with same protection as execute
+    virtual void timeout(event_timer *) { }
+
+    // Called for tracked executor once distributor starts draining and
+    // again after every execute till executor closes, with same protection
+    // as execute. Executor still open at drain deadline is force closed.
+    virtual void drain() { }
+
     friend class event_distributor;
+    friend class epoch_manager;
 
 public:
     virtual ~event_executor() = default;
 
+    constexpr bool has_error_queue() const { return error_queue; }
+
+    // Off by default, spin only pays when thread is dedicated to
+    // latency critical sockets and is otherwise idle
+    inline void set_busy_poll(const int busy_poll_in_us) {
+        this->busy_poll_in_us = static_cast<uint16_t>(std::clamp(busy_poll_in_us, 0, config::event_dist_max_busy_poll_in_us));
+    }
+
+    constexpr int get_busy_poll() const { return busy_poll_in_us; }
+
     // Make sure to call enter loop before making this call
     inline void execute_protector_noenter() {
         assert(executor_count >= 1);
@@ -62,7 +130,7 @@ public:
                 // This will prevent other thread to enter
                 break;
             }
-            execute();
+            dispatch();
             loop = !exit_loop();
         }
     }
@@ -78,11 +146,27 @@ public:
                 // This will prevent other thread to enter
                 break;
             }
-            execute();
+            dispatch();
             loop = !exit_loop();
         }
     }
 
+    // Returns false if executor is running in other thread
+    inline bool timeout_protector(event_timer *timer) {
+        if (!enter_loop()) {
+            // Running thread will execute again
+            return false;
+        }
+
+        if (closed) {
+            close();
+            return true;
+        }
+        timeout(timer);
+        if (!exit_loop()) execute_protector_noenter();
+        return true;
+    }
+
     inline void mark_closed(bool readclose) {
         closed = true;
         auto loop = enter_loop();
@@ -96,6 +180,17 @@ public:
         }
     }
 
+    // True while compute job submitted for this executor is in flight
+    inline bool is_held() const {
+        return (holds.load(std::memory_order_acquire) & ~hold_retired) != 0;
+    }
+
+    // Drain is served by thread holding executor, in place of one execute
+    inline void drain_protector() {
+        drain_requested.store(true, std::memory_order_relaxed);
+        if (enter_loop()) execute_protector_noenter();
+    }
+
     inline bool enter_loop() {
         auto value = executor_count++;
         return value == 0;
@@ -105,110 +200,426 @@ public:
         return --executor_count == 0;
     }
 
+private:
+    inline void dispatch() {
+        if (drain_requested.load(std::memory_order_relaxed)) [[unlikely]] {
+            drain_requested.store(false, std::memory_order_relaxed);
+            draining = true;
+            drain();
+            return;
+        }
+
+        execute();
+        if (draining) [[unlikely]] drain();
+    }
+
 }; // class event_executor
 
-class event_cleanup {
+// Work handed to a loop thread, task is deleted after run
+class event_task {
+private:
+    event_task *next { nullptr };
+
+    friend class task_queue_executor;
+
+public:
+    virtual ~event_task() = default;
+    virtual void run() = 0;
+};
+
+template <typename FUNC>
+class event_task_function : public event_task {
 private:
-    event_executor *const ptr;
-    const uint64_t timestamp;
+    FUNC function;
 
 public:
-    inline event_cleanup(event_executor *ptr)
-            : ptr(ptr), timestamp(std::chrono::system_clock::now().time_since_epoch().count()) { }
+    template <typename ARG>
+    inline event_task_function(ARG &&function) : function(std::forward<ARG>(function)) { }
+    void run() override { function(); }
+};
 
-    inline bool to_free() const {
-        const uint64_t current_timestamp = std::chrono::system_clock::now().time_since_epoch().count();
-        return timestamp + config::event_cleanup_time_in_ns <= current_timestamp;
+// Multiple producer single consumer queue of tasks for one shard
+// Producers push on lock free stack, consumer takes whole stack at once.
+// Doorbell eventfd is written only when stack goes from empty to non empty,
+// so one wakeup covers all the tasks posted till consumer takes them.
+class task_queue_executor : public event_executor {
+private:
+    alignas(64) std::atomic<event_task *> head { nullptr };
+    const int doorbellfd;
+
+public:
+    inline task_queue_executor() : doorbellfd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+        if (doorbellfd == -1) {
+            log<log_t::EVENT_DIST_TASK_QUEUE_CREATE_FAILED>(errno);
+            throw exception_t(err_t::EVENT_DIST_CREATE_FAILED);
+        }
+    }
+
+    inline ~task_queue_executor() {
+        // Tasks not run by the time loop threads are terminated are dropped
+        auto task = head.exchange(nullptr, std::memory_order_acquire);
+        while(task) {
+            auto next = task->next;
+            delete task;
+            task = next;
+        }
+        ::close(doorbellfd);
+    }
+
+    constexpr int get_fd() const { return doorbellfd; }
+
+    inline void push(event_task *task) {
+        auto old_head = head.load(std::memory_order_relaxed);
+        do {
+            task->next = old_head;
+        } while (!head.compare_exchange_weak(old_head, task, std::memory_order_release, std::memory_order_relaxed));
+
+        if (old_head == nullptr) {
+            const uint64_t value = 1;
+            if (::write(doorbellfd, &value, sizeof(value)) != sizeof(value) && errno != EAGAIN) {
+                log<log_t::EVENT_DIST_TASK_DOORBELL_FAILED>(errno);
+            }
+        }
     }
 
-    inline void remove_and_free(std::unordered_set<event_executor *> &closed_received) {
-        closed_received.erase(ptr);
-        delete ptr;
+private:
+    void execute() override {
+        // Doorbell is read before taking tasks, push after this rings again
+        uint64_t value;
+        while (::read(doorbellfd, &value, sizeof(value)) > 0) { }
+
+        auto task = head.exchange(nullptr, std::memory_order_acquire);
+
+        // Stack is in reverse order of posting
+        event_task *ordered = nullptr;
+        while(task) {
+            auto next = task->next;
+            task->next = ordered;
+            ordered = task;
+            task = next;
+        }
+
+        while(ordered) {
+            auto next = ordered->next;
+            ordered->run();
+            delete ordered;
+            ordered = next;
+        }
     }
+
+    void flush() override { }
+
+    // Owned by event_distributor
+    void close() override { }
 };
 
-struct event_thread_entry {
-    pthread_t pthread;
-    state_t state;
-    uint64_t timestamp;
+// Wakes loop threads on terminate, loop threads check terminate flag
+// after every wait so execute has nothing to do
+class terminate_executor : public event_executor {
+private:
+    void execute() override { }
+    void flush() override { }
 
-    inline event_thread_entry() {}
+    // Owned by event_distributor
+    void close() override { }
+};
 
-    inline event_thread_entry(const pthread_t pthread)
-            :   pthread(pthread),
-                state(state_t::EVENT_DIST_NONE),
-                timestamp(std::chrono::system_clock::now().time_since_epoch().count())  { }
+class event_distributor;
 
+// One slot for each loop thread, index is fixed at thread creation
+// Slot is written by owner thread and read by cleanup thread
+struct alignas(64) event_thread_entry {
+    event_distributor *evtdist { nullptr };
+    size_t thread_index { 0 };
+    pthread_t pthread { };
+    state_t state { state_t::EVENT_DIST_NONE };
+    uint64_t timestamp { 0 };
+
+    // Batch statistics, written only by owner thread
+    uint64_t wakeup_count { 0 };
+    uint64_t event_count { 0 };
+    size_t batch_size { config::event_dist_min_batch };
+
+    // Largest busy poll budget of executors served since last wait
+    int spin_in_us { 0 };
+
+    // Last values reported by cleanup thread
+    uint64_t reported_wakeup_count { 0 };
+    uint64_t reported_event_count { 0 };
+
+    // Executors that used up I/O budget, executed again after current batch
+    std::vector<event_executor *> ready { };
+    std::vector<event_executor *> ready_running { };
+
+    // Dispatch to complete latency for each executor type, slot is claimed
+    // by owner thread on first event of type and never released
+    struct latency_slot {
+        std::atomic<const std::type_info *> type { nullptr };
+        latency_histogram histogram { };
+    };
+    std::unique_ptr<latency_slot[]> latency_slots { new latency_slot[config::event_dist_latency_type_count] };
+
+    // Types after all slots are claimed
+    latency_histogram latency_overflow { };
+
+    // Only deadlock detector reads timestamp, coarse clock is enough
     inline void set_state(const state_t state) {
         this->state = state;
-        timestamp = std::chrono::system_clock::now().time_since_epoch().count();
+        timestamp = coarse_now_ns();
+    }
+
+    inline void record_latency(const std::type_info *type, const uint64_t latency_ns) {
+        const size_t start = (reinterpret_cast<uintptr_t>(type) >> 4) % config::event_dist_latency_type_count;
+        size_t index = start;
+        do {
+            auto &slot = latency_slots[index];
+            const auto slot_type = slot.type.load(std::memory_order_relaxed);
+            if (slot_type == type) {
+                slot.histogram.record(latency_ns);
+                return;
+            }
+            if (slot_type == nullptr) {
+                slot.histogram.record(latency_ns);
+                slot.type.store(type, std::memory_order_release);
+                return;
+            }
+            index = (index + 1) % config::event_dist_latency_type_count;
+        } while (index != start);
+        latency_overflow.record(latency_ns);
+    }
+
+    // Batch grows when epoll_wait fills it and shrinks when mostly empty
+    inline void update_batch(const size_t ready_count, const size_t max_batch_size) {
+        ++wakeup_count;
+        event_count += ready_count;
+        if (ready_count == batch_size) {
+            batch_size = std::min(batch_size * 2, max_batch_size);
+        } else if (ready_count * 4 < batch_size) {
+            batch_size = std::max(batch_size / 2, static_cast<size_t>(config::event_dist_min_batch));
+        }
     }
 };
 
+// Latency of one executor type merged over all loop threads
+struct latency_report {
+    const std::type_info *type;
+    latency_snapshot snapshot;
+};
+
 class helperevent_executor;
 
+enum class event_mode_t {
+    SHARED,  // One epoll shared by all the loop threads
+    SHARDED, // One epoll per loop thread, accepted peers stay on accepting thread
+};
+
 class event_distributor {
 public:
     static constexpr int max_event_size = 1000000;
     static constexpr int max_thread_supported = 64;
-    static constexpr int event_wait_count = 1;
 
     static constexpr uint64_t cleanup_loop_time_in_ns = 2ULL * 1000ULL * 1000000ULL; // two second
 
 private:
-    int epollfd;
+    const event_mode_t mode;
+
+    // SHARED mode has only one entry
+    // SHARDED mode has one entry for each loop thread
+    std::vector<int> epollfds;
+
+    // One task queue for each shard
+    std::vector<std::unique_ptr<task_queue_executor>> task_queues;
+
+    // One timer wheel for each loop thread
+    std::vector<std::unique_ptr<timer_wheel>> wheels;
+    size_t shard_count;
     size_t thread_count;
-    std::unordered_map<pthread_t, event_thread_entry> thread_entry_map;
+    const size_t max_batch_size;
+
+    // Bytes one executor may read in one dispatch before it is deferred
+    std::atomic<size_t> io_budget { config::event_dist_io_budget_in_bytes };
+
+    // CPUs of each loop thread, empty set means not pinned
+    const thread_placement_t placement_policy;
+    std::vector<cpu_set_t> thread_cpus;
+
+    // Slots of loop threads, only first started_thread_count are valid
+    std::unique_ptr<event_thread_entry[]> thread_entries;
+    std::atomic<size_t> started_thread_count { 0 };
+    pthread_t cleanup_thread { };
+
+    std::atomic<bool> is_terminate;
+
+    // Registered level triggered on every shard, so that all the threads
+    // waiting on shared epoll wake up from one write
+    int terminatefd { -1 };
+    terminate_executor terminator { };
+
+    // Executors drained on shutdown, one list for each shard
+    struct tracked_list : public pthread_lock_c<true> {
+        event_executor *head { nullptr };
+    };
+    std::unique_ptr<tracked_list[]> tracked_lists;
+    std::atomic<size_t> tracked_count { 0 };
+    std::atomic<bool> is_draining { false };
+
+    // Loop threads of each shard blocked with nothing pending to be freed
+    std::unique_ptr<std::atomic<size_t>[]> idle_counts;
+
+    // Signalled when tracked count drops to zero while draining
+    // and on terminate, waits use CLOCK_MONOTONIC
+    pthread_mutex_t state_lock;
+    pthread_cond_t state_cond;
+
+    template <typename FUNC>
+    inline void post_to_shard(const size_t shard_index, FUNC &&function) {
+        task_queues[shard_index]->push(new event_task_function<std::decay_t<FUNC>>(std::forward<FUNC>(function)));
+    }
 
-    bool is_terminate;
+    void notify_state();
+    bool wait_drained(const int timeout_in_ms);
+    void drain_shard(const size_t shard_index, const bool force);
 
     // This is a loop will keep on executing
     // till it exit
-    static void *loop(void *pevtdist);
+    static void *loop(void *pthread_entry);
     static void *cleanup(void *pevtdist);
 
-    pthread_mutex_t eventdist_lock;
-    std::unordered_set<event_executor *> closed_received;
-    std::queue<event_cleanup> cleanup_queue;
+    static void loop_epoll(event_distributor *pevtdist, event_thread_entry &thread_entry);
+    static void run_ready(event_distributor *pevtdist, event_thread_entry &thread_entry);
+    static void release_ready(event_distributor *pevtdist, event_thread_entry &thread_entry);
 
-    friend class terminate_executor;
+    epoch_manager epoch;
 
 public:
     // Delayed free can be called while transfer
-    // true = Entry was not made, executor can be called for config::event_cleanup_time_in_ns time
+    // executor is freed once no loop thread can be holding it
+    // true = Entry was made, false = executor was already retired
     inline bool delayed_free(event_executor *ptr) {
-        bool call_execute = false;
-        pthread_mutex_lock(&eventdist_lock);
-        if (closed_received.find(ptr) == closed_received.end()) {
-            // Entry has not been made yet
-            call_execute = true;
-            closed_received.insert(ptr);
-            cleanup_queue.push({ ptr });
-        }
-        pthread_mutex_unlock(&eventdist_lock);
-        return call_execute;
+        if (ptr->retired.exchange(true)) return false;
+        untrack(ptr);
+        if (ptr->holds.fetch_or(event_executor::hold_retired, std::memory_order_acq_rel) == 0) retire(ptr);
+        return true;
+    }
+
+    // Keeps executor from being freed while compute job is in flight
+    inline void hold(event_executor *ptr) {
+        ptr->holds.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    inline void release_hold(event_executor *ptr) {
+        if (ptr->holds.fetch_sub(1, std::memory_order_acq_rel) == (event_executor::hold_retired | 1)) retire(ptr);
+    }
+
+    // Thread waiting with nothing pending keeps epoch it announced, retire
+    // wakes it. Returns false if something was retired meanwhile.
+    inline bool enter_idle(const size_t shard_index) {
+        if (epoch.has_pending()) return false;
+        idle_counts[shard_index].fetch_add(1, std::memory_order_seq_cst);
+        if (!epoch.has_pending()) return true;
+        leave_idle(shard_index);
+        return false;
+    }
+
+    inline void leave_idle(const size_t shard_index) {
+        idle_counts[shard_index].fetch_sub(1, std::memory_order_release);
     }
 
 private:
-    inline void add_thread_map(pthread_t pthread) {
-        event_thread_entry thread_entry(pthread);
-        thread_entry_map.insert(std::make_pair(pthread, thread_entry));
+    inline void retire(event_executor *ptr) {
+        if (ctx_is_loop_thread()) {
+            epoch.retire(ctx_thread_index(), ptr);
+        } else {
+            epoch.retire_orphan(ptr);
+        }
+        for(size_t shard_index = 0; shard_index < shard_count; ++shard_index) {
+            wake_idle(shard_index);
+        }
+    }
+
+    // Doorbell wakes one thread of shard, woken thread wakes next one
+    // till every idle thread has announced epoch or nothing is pending
+    inline void wake_idle(const size_t shard_index) {
+        if (idle_counts[shard_index].load(std::memory_order_seq_cst) == 0) return;
+        auto wake = [this, shard_index] {
+            if (epoch.has_pending()) wake_idle(shard_index);
+        };
+        task_queues[shard_index]->push(new event_task_function<decltype(wake)>(wake));
     }
 
     std::unique_ptr<helperevent_executor> helperevent;
+    std::unique_ptr<compute_pool> compute;
+
+    // Loop thread uses its own shard in SHARDED mode
+    // all other threads uses first shard
+    size_t current_shard() const;
+    size_t ctx_wheel_index() const;
+    bool ctx_is_loop_thread() const;
+    size_t ctx_thread_index() const;
 
 public:
-    event_distributor(const int thread_count = 0, const int max_event_size = event_distributor::max_event_size);
+    event_distributor(
+            const int thread_count = 0,
+            const event_mode_t mode = event_mode_t::SHARED,
+            const int max_batch_size = config::event_dist_max_batch,
+            const thread_placement &placement = { },
+            const int max_event_size = event_distributor::max_event_size);
+
+    ~event_distributor();
 
     void init();
 
+    // Creates compute pool, must be called after init
+    void init_compute(const size_t compute_thread_count);
+    inline compute_pool *get_compute_pool() const { return compute.get(); }
+
+    // Latency histograms are read while loops keep running
+    // Type nullptr collects executor types that did not get a slot
+    std::vector<latency_report> get_latency_reports() const;
+    latency_snapshot get_thread_latency(const size_t thread_index) const;
+
+    // Job runs on compute thread and owner is executed on its loop thread
+    // once job is done. Without compute pool job runs before this returns.
+    void submit_job(event_executor *owner, compute_job *job);
+
     // event_executor memory will be used directly
     // clean up is responsibility of event_executor
     // itself.
     inline err_t add(const int fd, const uint32_t event, event_executor *pexecutor) const {
+        return add_shard(current_shard(), fd, event, pexecutor);
+    }
+
+    // Adds fd to all the shards, in SHARED mode this is same as add
+    inline err_t add_all(const int fd, const uint32_t event, event_executor *pexecutor) const {
+        for(size_t shard_index = 0; shard_index < shard_count; ++shard_index) {
+            auto err = add_shard(shard_index, fd, event, pexecutor);
+            if (isFailure(err)) return err;
+        }
+        return err_t::SUCCESS;
+    }
+
+    inline err_t add_shard(const size_t shard_index, const int fd, const uint32_t event, event_executor *pexecutor) const {
+        return register_shard(shard_index, fd, event | EPOLLET | EPOLLRDHUP, pexecutor);
+    }
+
+    // Listening fd shared by all the shards, epoll wakes only one of the
+    // waiting threads. Executor is owned by first shard.
+    inline err_t add_exclusive(const int fd, const uint32_t event, event_executor *pexecutor) const {
+        if (shard_count == 1) return add_shard(0, fd, event, pexecutor);
+        for(size_t shard_index = shard_count; shard_index-- > 0;) {
+            auto err = register_shard(shard_index, fd, event | EPOLLET | EPOLLEXCLUSIVE, pexecutor);
+            if (isFailure(err)) return err;
+        }
+        return err_t::SUCCESS;
+    }
+
+private:
+    // events are passed as is, add_shard makes them edge triggered
+    inline err_t register_shard(const size_t shard_index, const int fd, const uint32_t events, event_executor *pexecutor) const {
         epoll_event epoll_data;
-        epoll_data.events = event | EPOLLET | EPOLLRDHUP;
+        epoll_data.events = events;
         epoll_data.data.ptr = pexecutor;
+        pexecutor->owner_shard = shard_index;
 
         if constexpr (config::debug) {
             if (fd == 0) {
@@ -216,7 +627,7 @@ public:
             }
         }
 
-        auto ret = epoll_ctl(epollfd, EPOLL_CTL_ADD, fd, &epoll_data);
+        auto ret = epoll_ctl(epollfds[shard_index], EPOLL_CTL_ADD, fd, &epoll_data);
 
         if (ret == -1) {
             log<log_t::EVENT_CREATE_FAILED>(fd, errno);
@@ -227,9 +638,12 @@ public:
         }
     }
 
-    inline err_t remove(const int fd) {
-        auto ret = epoll_ctl(epollfd, EPOLL_CTL_DEL, fd, nullptr);
-            if (ret == -1) {
+public:
+    // fd is removed from epoll of shard executor was added to, caller may
+    // run on thread of other shard
+    inline err_t remove(const int fd, const event_executor *pexecutor) {
+        auto ret = epoll_ctl(epollfds[pexecutor->owner_shard], EPOLL_CTL_DEL, fd, nullptr);
+        if (ret == -1) {
             log<log_t::EVENT_REMOVE_FAILED>(fd, errno);
             return err_t::EVENT_REMOVE_FAILED;
         } else {
@@ -238,12 +652,114 @@ public:
         }
     }
 
+    // Task runs on loop thread thread_index, in SHARED mode loop threads
+    // share one queue and any of them runs the task. Tasks posted to
+    // the same thread run in order they are posted.
+    inline void post(const size_t thread_index, event_task *task) {
+        const size_t shard_index = mode == event_mode_t::SHARDED ? thread_index % shard_count : 0;
+        task_queues[shard_index]->push(task);
+    }
+
+    template <typename FUNC> requires std::invocable<FUNC &>
+    inline void post(const size_t thread_index, FUNC &&function) {
+        post(thread_index, new event_task_function<std::decay_t<FUNC>>(std::forward<FUNC>(function)));
+    }
+
+    // Task runs on thread serving executor, executor is not locked.
+    // Caller must make sure executor is not freed before task runs.
+    inline void post_to_owner(const event_executor *executor, event_task *task) {
+        task_queues[executor->owner_shard]->push(task);
+    }
+
+    template <typename FUNC> requires std::invocable<FUNC &>
+    inline void post_to_owner(const event_executor *executor, FUNC &&function) {
+        post_to_owner(executor, new event_task_function<std::decay_t<FUNC>>(std::forward<FUNC>(function)));
+    }
+
+    // Timer is armed on wheel of current loop thread, thread other than
+    // loop thread uses first wheel. Timer must be armed or cancelled only
+    // from executor it belongs to, i.e. execute, timeout or close.
+    inline void arm_timer(event_timer &timer, const uint64_t timeout_in_ms) {
+        const auto wheel_index = ctx_wheel_index();
+        wheels[wheel_index]->arm(timer, timeout_in_ms);
+    }
+
+    // Tracked executors are drained by drain, executor is untracked by
+    // untrack or when handed to delayed_free. Must be called after executor
+    // is added, executor tracked while draining is drained right away.
+    inline void track(event_executor *executor) {
+        auto &list = tracked_lists[executor->owner_shard];
+        list.lock();
+        const bool added = !executor->tracked.load(std::memory_order_relaxed);
+        if (added) {
+            executor->tracked_shard = executor->owner_shard;
+            executor->tracked_prev = nullptr;
+            executor->tracked_next = list.head;
+            if (list.head) list.head->tracked_prev = executor;
+            list.head = executor;
+            executor->tracked.store(true, std::memory_order_relaxed);
+            ++tracked_count;
+        }
+        list.unlock();
+
+        if (added && is_draining.load(std::memory_order_acquire)) executor->drain_protector();
+    }
+
+    inline void untrack(event_executor *executor) {
+        if (!executor->tracked.load(std::memory_order_relaxed)) return;
+        auto &list = tracked_lists[executor->tracked_shard];
+        list.lock();
+        const bool removed = executor->tracked.load(std::memory_order_relaxed);
+        if (removed) {
+            if (executor->tracked_prev) {
+                executor->tracked_prev->tracked_next = executor->tracked_next;
+            } else {
+                list.head = executor->tracked_next;
+            }
+            if (executor->tracked_next) executor->tracked_next->tracked_prev = executor->tracked_prev;
+            executor->tracked.store(false, std::memory_order_relaxed);
+        }
+        list.unlock();
+
+        if (removed && --tracked_count == 0 && is_draining.load(std::memory_order_acquire)) notify_state();
+    }
+
+    inline size_t get_tracked_count() const { return tracked_count.load(std::memory_order_relaxed); }
+
+    // 0 is no budget, executor reads till socket is drained
+    inline void set_io_budget(const size_t budget_in_bytes) {
+        io_budget.store(budget_in_bytes == 0 ? SIZE_MAX : budget_in_bytes, std::memory_order_relaxed);
+    }
+
+    inline size_t get_io_budget() const { return io_budget.load(std::memory_order_relaxed); }
+
+    // Executor is executed again by this loop thread once current batch is
+    // dispatched. Executor is held till then. Must be called from loop thread.
+    inline void defer(event_executor *executor) {
+        if (executor->ready_queued.exchange(true, std::memory_order_acq_rel)) return;
+        hold(executor);
+        thread_entries[ctx_thread_index()].ready.push_back(executor);
+    }
+
     constexpr size_t get_thread_count() const { return thread_count; }
+    constexpr size_t get_max_batch_size() const { return max_batch_size; }
+    constexpr event_mode_t get_mode() const { return mode; }
+    constexpr bool is_sharded() const { return mode == event_mode_t::SHARDED; }
+    constexpr size_t get_shard_count() const { return shard_count; }
+    constexpr thread_placement_t get_placement() const { return placement_policy; }
 
+    // Joins all the threads, epoll is closed once loop threads exit
     void wait();
 
+    // Asks tracked executors to finish and close, e.g. listeners stop
+    // accepting and peers flush pending writes. Executors still open after
+    // timeout are force closed. Returns true if all closed before timeout.
+    // Must not be called from loop thread.
+    bool drain(const int timeout_in_ms = config::event_dist_drain_timeout_in_ms);
+
+    // Loop threads exit after their current batch, does not wait for them
     void terminate();
-    bool isTerminated() const { return is_terminate; }
+    bool isTerminated() const { return is_terminate.load(std::memory_order_acquire); }
 
     bool pause();
     bool resume();
@@ -253,13 +769,21 @@ public:
 class thread_context {
 private:
     event_distributor *evtdist { nullptr };
+    size_t thread_index { 0 };
+
+    // Bytes left for executor being dispatched, unlimited outside loop
+    size_t io_budget_left { SIZE_MAX };
 
     friend event_distributor;
 public:
     inline thread_context() {}
 
-    inline err_t remove_event(const int fd) {
-        return evtdist->remove(fd);
+    // This is valid only for loop thread
+    constexpr size_t get_thread_index() const { return thread_index; }
+    constexpr bool is_loop_thread(const event_distributor *pevtdist) const { return evtdist == pevtdist; }
+
+    inline err_t remove_event(const int fd, const event_executor *pexecutor) {
+        return evtdist->remove(fd, pexecutor);
     }
 
     inline bool delayed_free(event_executor *executor) {
@@ -270,9 +794,66 @@ public:
         return evtdist->add(fd, event, pexecutor);
     }
 
+    inline void arm_timer(event_timer &timer, const uint64_t timeout_in_ms) {
+        evtdist->arm_timer(timer, timeout_in_ms);
+    }
+
+    // This can be called from any thread
+    inline void cancel_timer(event_timer &timer) {
+        timer_wheel::disarm(timer);
+    }
+
+    // Returns false once executor being dispatched has read its budget,
+    // caller must stop reading and defer itself
+    inline bool consume_io_budget(const size_t bytes) {
+        if (io_budget_left <= bytes) {
+            io_budget_left = 0;
+            return false;
+        }
+        io_budget_left -= bytes;
+        return true;
+    }
+
+    // Loop thread resets budget before every dispatch
+    inline void reset_io_budget(const size_t budget) { io_budget_left = budget; }
+
+    inline void defer(event_executor *executor) {
+        evtdist->defer(executor);
+    }
+
+    inline void submit_job(event_executor *owner, compute_job *job) {
+        evtdist->submit_job(owner, job);
+    }
+
+    inline void track_event(event_executor *executor) {
+        evtdist->track(executor);
+    }
+
+    inline void untrack_event(event_executor *executor) {
+        evtdist->untrack(executor);
+    }
+
     static constexpr size_t buffer_size = 16384;
     uint8_t read_buffer[buffer_size]; // Read buffer size;
     uint8_t write_buffer[buffer_size]; // Write buffer size
 }; // class thread_context
 
+inline size_t event_distributor::current_shard() const {
+    if (mode == event_mode_t::SHARED || !ctx.is_loop_thread(this)) return 0;
+    return ctx.get_thread_index();
+}
+
+inline bool event_distributor::ctx_is_loop_thread() const {
+    return ctx.is_loop_thread(this);
+}
+
+inline size_t event_distributor::ctx_thread_index() const {
+    return ctx.get_thread_index();
+}
+
+inline size_t event_distributor::ctx_wheel_index() const {
+    if (!ctx.is_loop_thread(this)) return 0;
+    return ctx.get_thread_index();
+}
+
 } // namespace rohit
\ No newline at end of file
@@ -0,0 +1,135 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <iot/core/config.hh>
+#include <atomic>
+#include <chrono>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace rohit {
+
+class event_executor;
+class timer_wheel;
+
+// Intrusive timer, executor keeps it as member. No allocation is done
+// to arm, re-arm or cancel a timer.
+// Timer must be cancelled before executor is freed.
+// Wheel is kept as id and expiry as low 32 bits of tick, so that timer
+// is 32 bytes for every connection.
+class event_timer {
+private:
+    event_timer *next { nullptr };
+    event_timer **pprev { nullptr };
+    event_executor *const executor;
+    uint32_t expiry_tick { 0 };
+    uint16_t slot_index { 0 };
+    uint16_t wheel_id { 0 };
+
+    friend class timer_wheel;
+
+public:
+    constexpr event_timer(event_executor *executor) : executor(executor) { }
+
+    event_timer(const event_timer &) = delete;
+    event_timer &operator=(const event_timer &) = delete;
+
+    constexpr bool is_armed() const { return wheel_id != 0; }
+    constexpr event_executor *get_executor() const { return executor; }
+};
+
+// Hierarchical timing wheel, level 0 slot is one tick
+// each next level slot is 64 times of previous level.
+// Timers beyond last level are parked in last level and cascaded again.
+class timer_wheel {
+public:
+    static constexpr size_t level_bits = 6;
+    static constexpr size_t slot_count = 1 << level_bits;
+    static constexpr size_t slot_mask = slot_count - 1;
+    static constexpr size_t level_count = 4;
+    static constexpr uint64_t max_delta = 1ULL << (level_bits * level_count);
+
+    // Longer timeout is cut short, expiry_tick must not wrap
+    static constexpr uint64_t max_timeout_tick = 1ULL << 31;
+
+    // Timer unlinked to fire is still owned by wheel, cancel or arm
+    // while executor is busy in other thread stops wheel re-arming it
+    static constexpr uint16_t firing_slot = UINT16_MAX;
+
+    static constexpr size_t max_wheel_count = 1024;
+
+private:
+    static inline std::atomic<timer_wheel *> wheel_registry[max_wheel_count] { };
+    static timer_wheel *from_id(const uint16_t wheel_id) {
+        return wheel_registry[wheel_id - 1].load(std::memory_order_acquire);
+    }
+
+    // 1 based index in wheel_registry, 0 in timer is not armed
+    uint16_t id;
+
+    event_timer *slots[level_count][slot_count] { };
+    uint64_t occupied[level_count] { };
+    uint64_t current_tick;
+    size_t timer_count { 0 };
+
+    // Only owner thread advances the wheel, lock protects arm or cancel from other threads
+    pthread_mutex_t lock;
+
+    inline void insert(event_timer &timer);
+    inline void unlink(event_timer &timer);
+    inline void cascade(const size_t level);
+    inline uint64_t expiry_of(const event_timer &timer) const;
+
+public:
+    static inline uint64_t now_tick() {
+        const auto now = std::chrono::steady_clock::now().time_since_epoch();
+        return std::chrono::duration_cast<std::chrono::milliseconds>(now).count() / config::timer_tick_in_ms;
+    }
+
+    timer_wheel();
+    ~timer_wheel();
+
+    timer_wheel(const timer_wheel &) = delete;
+    timer_wheel &operator=(const timer_wheel &) = delete;
+
+    // Arms or re-arms timer, timer can be armed on another wheel
+    void arm(event_timer &timer, const uint64_t timeout_in_ms);
+    void cancel(event_timer &timer);
+
+    // Cancels timer from whichever wheel it is armed on
+    static inline void disarm(event_timer &timer) {
+        if (timer.wheel_id != 0) from_id(timer.wheel_id)->cancel(timer);
+    }
+
+    // Time left till timer is due, 0 if it is not armed or already due
+    static inline uint64_t remaining_in_ms(const event_timer &timer) {
+        if (timer.wheel_id == 0) return 0;
+        const int32_t delta = static_cast<int32_t>(timer.expiry_tick - static_cast<uint32_t>(now_tick()));
+        return delta > 0 ? static_cast<uint64_t>(delta) * config::timer_tick_in_ms : 0;
+    }
+
+    // Fires all the timers expired till now, timer of executor busy in
+    // other thread is fired again on next tick
+    void advance();
+
+    // Wait time in milliseconds till next expiry, -1 if there is no timer
+    int next_timeout_in_ms();
+
+    inline size_t get_timer_count() const { return timer_count; }
+};
+
+} // namespace rohit
@@ -53,7 +53,8 @@ public:
     }
 
     inline void init() {
-        evtdist.add(evtfd, EPOLLIN, this);
+        // Helper must reach threads of every shard
+        evtdist.add_all(evtfd, EPOLLIN, this);
     }
 
     // This is blocking event
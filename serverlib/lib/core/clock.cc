@@ -0,0 +1,66 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <iot/core/clock.hh>
+#include <iot/core/config.hh>
+#include <mutex>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace rohit {
+
+bool cycle_clock::use_tsc = false;
+uint64_t cycle_clock::ns_per_tick = 1ULL << 32;
+
+static inline uint64_t raw_now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// CPUID 0x80000007 EDX bit 8, TSC rate does not change with P/C states
+static bool has_invariant_tsc() {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007) return false;
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) return false;
+    return (edx & (1U << 8)) != 0;
+}
+#endif
+
+void cycle_clock::calibrate() {
+    static std::once_flag calibrated;
+    std::call_once(calibrated, [] {
+#if defined(__x86_64__) || defined(__i386__)
+        if (!has_invariant_tsc()) return;
+
+        const auto start_ns = raw_now_ns();
+        const auto start_tick = __rdtsc();
+        uint64_t end_ns;
+        do {
+            end_ns = raw_now_ns();
+        } while (end_ns - start_ns < config::cycle_clock_calibrate_in_ns);
+        const auto end_tick = __rdtsc();
+
+        if (end_tick <= start_tick) return;
+        ns_per_tick = static_cast<uint64_t>(
+            (static_cast<clock_uint128_t>(end_ns - start_ns) << 32) / (end_tick - start_tick));
+        use_tsc = true;
+#endif
+    });
+}
+
+} // namespace rohit
@@ -0,0 +1,225 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <iot/core/cpu_topology.hh>
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <tuple>
+
+namespace rohit {
+
+thread_placement_t to_thread_placement(const std::string &placement) {
+    if (placement == "compact") return thread_placement_t::COMPACT;
+    if (placement == "scatter") return thread_placement_t::SCATTER;
+    if (placement == "list") return thread_placement_t::LIST;
+    if (placement == "numa") return thread_placement_t::NUMA_NODE;
+    return thread_placement_t::NONE;
+}
+
+static constexpr const char *sysfs_cpu_path = "/sys/devices/system/cpu/";
+static constexpr const char *sysfs_node_path = "/sys/devices/system/node/";
+
+// Reads list like 0-3,8,10-11
+static std::vector<int> read_sysfs_list(const std::string &path) {
+    std::vector<int> values { };
+    std::ifstream file(path);
+    std::string list;
+    if (!std::getline(file, list)) return values;
+
+    size_t index = 0;
+    while (index < list.size()) {
+        auto end = list.find(',', index);
+        if (end == std::string::npos) end = list.size();
+        const auto range = list.substr(index, end - index);
+        index = end + 1;
+        if (range.empty()) continue;
+
+        const auto dash = range.find('-');
+        const int first = std::stoi(range.substr(0, dash));
+        const int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for(int value = first; value <= last; ++value) values.push_back(value);
+    }
+    return values;
+}
+
+static int read_sysfs_int(const std::string &path, const int default_value) {
+    std::ifstream file(path);
+    int value;
+    if (file >> value) return value;
+    return default_value;
+}
+
+cpu_topology::cpu_topology() {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        for(int cpu = 0; cpu < CPU_SETSIZE; ++cpu) CPU_SET(cpu, &allowed);
+    }
+
+    auto online = read_sysfs_list(std::string(sysfs_cpu_path) + "online");
+    if (online.empty()) {
+        const auto cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+        for(int cpu = 0; cpu < cpu_count; ++cpu) online.push_back(cpu);
+    }
+
+    std::map<int, int> cpu_node { };
+    for(auto node: read_sysfs_list(std::string(sysfs_node_path) + "online")) {
+        const auto node_path = std::string(sysfs_node_path) + "node" + std::to_string(node) + "/cpulist";
+        for(auto cpu: read_sysfs_list(node_path)) cpu_node[cpu] = node;
+    }
+
+    for(auto cpu: online) {
+        if (cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &allowed)) continue;
+        const auto topology_path = std::string(sysfs_cpu_path) + "cpu" + std::to_string(cpu) + "/topology/";
+        const auto node_itr = cpu_node.find(cpu);
+        cpus.push_back({
+            cpu,
+            read_sysfs_int(topology_path + "core_id", cpu),
+            read_sysfs_int(topology_path + "physical_package_id", 0),
+            node_itr != cpu_node.end() ? node_itr->second : 0
+        });
+
+        if (std::find(nodes.begin(), nodes.end(), cpus.back().node) == nodes.end()) {
+            nodes.push_back(cpus.back().node);
+        }
+    }
+    std::sort(nodes.begin(), nodes.end());
+}
+
+const cpu_topology &cpu_topology::get() {
+    static const cpu_topology topology { };
+    return topology;
+}
+
+int cpu_topology::node_of(const int cpu) const {
+    for(auto &info: cpus) {
+        if (info.cpu == cpu) return info.node;
+    }
+    return -1;
+}
+
+static std::vector<int> valid_cpu_list(const cpu_topology &topology, const std::vector<int> &cpu_list) {
+    std::vector<int> valid_list { };
+    for(auto cpu: cpu_list) {
+        if (topology.node_of(cpu) >= 0) valid_list.push_back(cpu);
+    }
+    return valid_list;
+}
+
+size_t cpu_topology::default_thread_count(const thread_placement &placement) const {
+    switch(placement.policy) {
+    case thread_placement_t::LIST: {
+        const auto valid_list = valid_cpu_list(*this, placement.cpu_list);
+        if (!valid_list.empty()) return valid_list.size();
+        break;
+    }
+    case thread_placement_t::NUMA_NODE:
+        return nodes.size();
+    default:
+        break;
+    }
+    return std::max<size_t>(cpus.size(), 1);
+}
+
+std::vector<cpu_set_t> cpu_topology::placement(const thread_placement &placement, const size_t thread_count) const {
+    std::vector<cpu_set_t> cpu_sets(thread_count);
+    for(auto &cpu_set: cpu_sets) CPU_ZERO(&cpu_set);
+    if (cpus.empty()) return cpu_sets;
+
+    std::vector<int> order { };
+    switch(placement.policy) {
+    case thread_placement_t::NONE:
+        return cpu_sets;
+
+    case thread_placement_t::COMPACT: {
+        auto sorted = cpus;
+        std::sort(sorted.begin(), sorted.end(), [](const cpu_info &lhs, const cpu_info &rhs) {
+            if (lhs.package != rhs.package) return lhs.package < rhs.package;
+            if (lhs.core != rhs.core) return lhs.core < rhs.core;
+            return lhs.cpu < rhs.cpu;
+        });
+        for(auto &info: sorted) order.push_back(info.cpu);
+        break;
+    }
+
+    case thread_placement_t::SCATTER: {
+        // Rank of CPU within its core and rank of core within its package
+        std::map<std::pair<int, int>, int> sibling_count { };
+        std::map<int, std::vector<int>> package_cores { };
+        std::vector<std::pair<std::tuple<int, int, int>, int>> ranked { };
+        auto sorted = cpus;
+        std::sort(sorted.begin(), sorted.end(), [](const cpu_info &lhs, const cpu_info &rhs) { return lhs.cpu < rhs.cpu; });
+        for(auto &info: sorted) {
+            const int sibling_rank = sibling_count[{ info.package, info.core }]++;
+            auto &cores = package_cores[info.package];
+            auto core_itr = std::find(cores.begin(), cores.end(), info.core);
+            if (core_itr == cores.end()) core_itr = cores.insert(cores.end(), info.core);
+            const int core_rank = static_cast<int>(core_itr - cores.begin());
+            ranked.push_back({ { sibling_rank, core_rank, info.package }, info.cpu });
+        }
+        std::sort(ranked.begin(), ranked.end());
+        for(auto &entry: ranked) order.push_back(entry.second);
+        break;
+    }
+
+    case thread_placement_t::LIST:
+        order = valid_cpu_list(*this, placement.cpu_list);
+        if (order.empty()) return cpu_sets;
+        break;
+
+    case thread_placement_t::NUMA_NODE:
+        for(size_t thread_index = 0; thread_index < thread_count; ++thread_index) {
+            const int node = nodes[thread_index % nodes.size()];
+            for(auto &info: cpus) {
+                if (info.node == node) CPU_SET(info.cpu, &cpu_sets[thread_index]);
+            }
+        }
+        return cpu_sets;
+    }
+
+    for(size_t thread_index = 0; thread_index < thread_count; ++thread_index) {
+        CPU_SET(order[thread_index % order.size()], &cpu_sets[thread_index]);
+    }
+    return cpu_sets;
+}
+
+int current_numa_node() {
+    unsigned int cpu, node;
+    if (getcpu(&cpu, &node) != 0) return -1;
+    return static_cast<int>(node);
+}
+
+void move_to_numa_node(const void *addr, const size_t size, const int node) {
+    if (node < 0 || cpu_topology::get().get_node_count() <= 1 || size == 0) return;
+
+    const uintptr_t page_size = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    const uintptr_t begin = reinterpret_cast<uintptr_t>(addr) & ~(page_size - 1);
+    const uintptr_t end = reinterpret_cast<uintptr_t>(addr) + size;
+
+    std::vector<void *> pages { };
+    for(uintptr_t page = begin; page < end; page += page_size) {
+        pages.push_back(reinterpret_cast<void *>(page));
+    }
+    std::vector<int> page_nodes(pages.size(), node);
+    std::vector<int> status(pages.size());
+
+    // Failure is not fatal, pages remain where they are
+    syscall(__NR_move_pages, 0, pages.size(), pages.data(), page_nodes.data(), status.data(), MPOL_MF_MOVE);
+}
+
+} // namespace rohit
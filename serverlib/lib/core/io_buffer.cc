@@ -0,0 +1,149 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <iot/core/io_buffer.hh>
+#include <new>
+
+namespace rohit {
+
+thread_local io_buffer_pool *io_buffer_pool::local_pool = nullptr;
+
+// Pool is released when thread exits, buffers still in use keep it alive
+struct io_buffer_pool_holder {
+    inline ~io_buffer_pool_holder() {
+        auto pool = io_buffer_pool::local_pool;
+        if (pool == nullptr) return;
+        io_buffer_pool::local_pool = nullptr;
+        pool->collect_remote();
+        pool->destroy_free_list();
+        pool->unref();
+    }
+};
+
+static thread_local io_buffer_pool_holder pool_holder;
+
+io_buffer *io_buffer_pool::create_buffer(const uint32_t size_class, const size_t capacity, io_buffer_pool *pool) {
+    void *memory = ::operator new(sizeof(io_buffer) + capacity, std::align_val_t { alignof(io_buffer) });
+    return new (memory) io_buffer(size_class, capacity, pool);
+}
+
+void io_buffer_pool::destroy_buffer(io_buffer *buffer) {
+    buffer->~io_buffer();
+    ::operator delete(buffer, std::align_val_t { alignof(io_buffer) });
+}
+
+void io_buffer::free() {
+    if (pool == nullptr) {
+        io_buffer_pool::destroy_buffer(this);
+        return;
+    }
+    pool->free(this);
+}
+
+io_buffer_pool &io_buffer_pool::local() {
+    if (local_pool == nullptr) {
+        // Touching holder registers its destructor for this thread
+        (void)&pool_holder;
+        local_pool = new io_buffer_pool();
+    }
+    return *local_pool;
+}
+
+io_buffer *io_buffer_pool::alloc(const size_t size) {
+    ++alloc_count;
+    uint32_t size_class = 0;
+    while (size_class < class_count && class_size[size_class] < size) ++size_class;
+    if (size_class == large_class) {
+        return create_buffer(large_class, size, nullptr);
+    }
+
+    if (free_list[size_class] == nullptr) collect_remote();
+
+    refcount.fetch_add(1, std::memory_order_relaxed);
+    auto buffer = free_list[size_class];
+    if (buffer == nullptr) {
+        return create_buffer(size_class, class_size[size_class], this);
+    }
+
+    ++reuse_count;
+    free_list[size_class] = buffer->next;
+    --free_count[size_class];
+    buffer->next = nullptr;
+    buffer->refcount.store(1, std::memory_order_relaxed);
+    return buffer;
+}
+
+void io_buffer_pool::free(io_buffer *buffer) {
+    if (this == local_pool) {
+        auto &count = free_count[buffer->size_class];
+        if (count < config::io_buffer_pool_max_free) {
+            buffer->next = free_list[buffer->size_class];
+            free_list[buffer->size_class] = buffer;
+            ++count;
+        } else {
+            destroy_buffer(buffer);
+        }
+    } else {
+        // Only owner takes from remote list and it takes whole list, no ABA
+        auto head = remote_list.load(std::memory_order_relaxed);
+        do {
+            buffer->next = head;
+        } while (!remote_list.compare_exchange_weak(
+                    head, buffer, std::memory_order_release, std::memory_order_relaxed));
+    }
+    unref();
+}
+
+void io_buffer_pool::collect_remote() {
+    auto buffer = remote_list.exchange(nullptr, std::memory_order_acquire);
+    while (buffer != nullptr) {
+        auto next = buffer->next;
+        auto &count = free_count[buffer->size_class];
+        if (count < config::io_buffer_pool_max_free) {
+            buffer->next = free_list[buffer->size_class];
+            free_list[buffer->size_class] = buffer;
+            ++count;
+        } else {
+            destroy_buffer(buffer);
+        }
+        buffer = next;
+    }
+}
+
+void io_buffer_pool::destroy_free_list() {
+    for (size_t size_class = 0; size_class < class_count; ++size_class) {
+        auto buffer = free_list[size_class];
+        while (buffer != nullptr) {
+            auto next = buffer->next;
+            destroy_buffer(buffer);
+            buffer = next;
+        }
+        free_list[size_class] = nullptr;
+        free_count[size_class] = 0;
+    }
+
+    // Released after owner thread exited
+    auto buffer = remote_list.exchange(nullptr, std::memory_order_acquire);
+    while (buffer != nullptr) {
+        auto next = buffer->next;
+        destroy_buffer(buffer);
+        buffer = next;
+    }
+}
+
+void io_buffer_pool::unref() {
+    if (refcount.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+}
+
+} // namespace rohit
@@ -21,6 +21,7 @@
 #include <sys/epoll.h>
 #include <cstring>
 #include <iostream>
+#include <atomic>
 #include <chrono>
 #include <thread>
 
@@ -314,7 +315,7 @@ void add_time_to_string_helper(
 }
 
 std::unique_ptr<std::thread> plog_thread;
-bool log_thread_running = false;
+std::atomic<bool> log_thread_running { false };
 
 void segv_log_flush() {
     logger::all.flush();
@@ -322,7 +323,6 @@ void segv_log_flush() {
 
 static void log_thread_function() {
     constexpr auto wait_time = std::chrono::milliseconds(config::log_thread_wait_in_millis);
-    log_thread_running = true;
     while(log_thread_running) {
         std::this_thread::sleep_for(wait_time);
         logger::all.flush();
@@ -343,6 +343,8 @@ void init_log_thread(const std::filesystem::path &filename) {
 
     logger::all.set_fd(log_filedescriptor);
 
+    // Set before thread starts, destroy right after init must still stop it
+    log_thread_running = true;
     plog_thread.reset(new std::thread { log_thread_function });
 }
 
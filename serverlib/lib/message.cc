@@ -28,7 +28,7 @@ std::ostream& operator<<(std::ostream& os, const rohit::message::CommandEntry &c
 
 std::ostream& operator<<(std::ostream& os, const rohit::message::Base &message) {
     rohit::message::Code code = message;
-    if (code > rohit::message::Code::COMMAND) {
+    if (code > rohit::message::Code::DISCONNECT) {
         return os << "Bad message " << static_cast<int>(code) << std::endl;
     }
     switch(message) {
@@ -42,6 +42,14 @@ std::ostream& operator<<(std::ostream& os, const rohit::message::Base &message)
         os << commandMessage.to_string();
         break;
     }
+
+    case rohit::message::Code::DISCONNECT: {
+        auto &disconnectMessage = static_cast<const rohit::message::Disconnect &>(message);
+        os << disconnectMessage.to_string()
+            << " reason " << static_cast<int>(disconnectMessage.get_reason())
+            << " reconnect after " << disconnectMessage.get_reconnect_delay_in_ms() << "ms" << std::endl;
+        break;
+    }
     
     default:
         break;
@@ -42,6 +42,8 @@ SSL_CTX *socket_ssl_t::create_context(bool isclient)
     }
 
     SSL_CTX_set_read_ahead(ctx, 1);
+    // Write retry may come from coalesce buffer of other loop thread
+    SSL_CTX_set_mode(ctx, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
     SSL_CTX_set_alpn_select_cb(ctx, alpn_cb, nullptr);
     SSL_CTX_set_next_protos_advertised_cb(ctx, alpn_negotiate_cb, nullptr);
     SSL_CTX_set_alpn_protos(ctx, proto_list, sizeof(proto_list));
@@ -0,0 +1,217 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <iot/states/compute_pool.hh>
+#include <iot/core/log.hh>
+#include <chrono>
+
+namespace rohit {
+
+static inline uint64_t compute_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+compute_pool::compute_pool(event_distributor &evtdist, const size_t thread_count)
+        :   evtdist(evtdist),
+            thread_count(std::min(std::max<size_t>(thread_count, 1), max_thread_supported)),
+            workers(new worker_entry[this->thread_count]) {
+    pthread_mutex_init(&idle_lock, nullptr);
+    pthread_cond_init(&idle_cond, nullptr);
+}
+
+compute_pool::~compute_pool() {
+    stop();
+    join();
+
+    // Jobs are owned by submitter, nothing to free
+    pthread_cond_destroy(&idle_cond);
+    pthread_mutex_destroy(&idle_lock);
+}
+
+void compute_pool::init() {
+    for(size_t index = 0; index < thread_count; ++index) {
+        worker_entry &worker = workers[index];
+        worker.pool = this;
+        worker.index = index;
+        auto ret = pthread_create(&worker.pthread, nullptr, &compute_pool::loop, &worker);
+        if (ret != 0) {
+            log<log_t::PTHREAD_CREATE_FAILED>(ret);
+            break;
+        }
+        started_thread_count = index + 1;
+    }
+
+    if (started_thread_count == 0) {
+        log<log_t::COMPUTE_POOL_CREATE_FAILED>();
+        throw exception_t(err_t::COMPUTE_POOL_CREATE_FAILED);
+    }
+
+    // Submit never picks worker that is not running
+    thread_count = started_thread_count;
+    log<log_t::COMPUTE_POOL_CREATED>(thread_count);
+}
+
+void compute_pool::submit(event_executor *owner, compute_job *job) {
+    job->owner = owner;
+    job->done.store(false, std::memory_order_relaxed);
+    job->submit_ns = compute_now_ns();
+    evtdist.hold(owner);
+
+    // Loop thread keeps using same compute thread, others are spread
+    const size_t index = ctx.is_loop_thread(&evtdist)
+                            ? ctx.get_thread_index() % thread_count
+                            : next_worker.fetch_add(1, std::memory_order_relaxed) % thread_count;
+    worker_entry &worker = workers[index];
+    worker.lock();
+    worker.jobs.push_back(job);
+    worker.unlock();
+
+    // Ordered with idle_count, waiting thread either sees this job or is signalled
+    pending_count.fetch_add(1, std::memory_order_seq_cst);
+    if (idle_count.load(std::memory_order_seq_cst) == 0) return;
+    pthread_mutex_lock(&idle_lock);
+    pthread_cond_signal(&idle_cond);
+    pthread_mutex_unlock(&idle_lock);
+}
+
+compute_job *compute_pool::take(const size_t index) {
+    {
+        worker_entry &worker = workers[index];
+        worker.lock();
+        if (!worker.jobs.empty()) {
+            auto job = worker.jobs.front();
+            worker.jobs.pop_front();
+            worker.unlock();
+            pending_count.fetch_sub(1, std::memory_order_relaxed);
+            return job;
+        }
+        worker.unlock();
+    }
+
+    for(size_t offset = 1; offset < thread_count; ++offset) {
+        worker_entry &victim = workers[(index + offset) % thread_count];
+        victim.lock();
+        if (!victim.jobs.empty()) {
+            auto job = victim.jobs.back();
+            victim.jobs.pop_back();
+            victim.unlock();
+            pending_count.fetch_sub(1, std::memory_order_relaxed);
+            return job;
+        }
+        victim.unlock();
+    }
+    return nullptr;
+}
+
+void compute_pool::run_job(compute_job *job) {
+    job->start_ns = compute_now_ns();
+    job->run();
+    job->finish_ns = compute_now_ns();
+
+    const auto queue_ns = job->get_queue_ns();
+    const auto run_ns = job->get_run_ns();
+    kind_stats &kind = stats[static_cast<size_t>(job->kind)];
+    kind.job_count.fetch_add(1, std::memory_order_relaxed);
+    kind.queue_ns.fetch_add(queue_ns, std::memory_order_relaxed);
+    kind.run_ns.fetch_add(run_ns, std::memory_order_relaxed);
+    auto max_run_ns = kind.max_run_ns.load(std::memory_order_relaxed);
+    while (max_run_ns < run_ns && !kind.max_run_ns.compare_exchange_weak(max_run_ns, run_ns, std::memory_order_relaxed)) { }
+    log<log_t::COMPUTE_JOB_COMPLETED>(static_cast<int>(job->kind), queue_ns, run_ns);
+
+    // Job may be freed by owner as soon as it is done
+    auto owner = job->owner;
+    job->done.store(true, std::memory_order_release);
+
+    event_distributor *pevtdist = &evtdist;
+    evtdist.post_to_owner(owner, [pevtdist, owner]() {
+        owner->execute_protector();
+        pevtdist->release_hold(owner);
+    });
+}
+
+void *compute_pool::loop(void *pvoid_worker) {
+    worker_entry &worker = *static_cast<worker_entry *>(pvoid_worker);
+    compute_pool *pool = worker.pool;
+
+    while(true) {
+        auto job = pool->take(worker.index);
+        if (job) {
+            pool->run_job(job);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->idle_lock);
+        pool->idle_count.fetch_add(1, std::memory_order_seq_cst);
+        while (pool->pending_count.load(std::memory_order_seq_cst) == 0 && !pool->is_stopping.load(std::memory_order_relaxed)) {
+            pthread_cond_wait(&pool->idle_cond, &pool->idle_lock);
+        }
+        pool->idle_count.fetch_sub(1, std::memory_order_relaxed);
+        const bool exit = pool->pending_count.load(std::memory_order_acquire) == 0;
+        pthread_mutex_unlock(&pool->idle_lock);
+        if (exit) break;
+    }
+
+    return nullptr;
+}
+
+void compute_pool::stop() {
+    pthread_mutex_lock(&idle_lock);
+    is_stopping.store(true, std::memory_order_relaxed);
+    pthread_cond_broadcast(&idle_cond);
+    pthread_mutex_unlock(&idle_lock);
+}
+
+void compute_pool::join() {
+    for(size_t index = 0; index < started_thread_count; ++index) {
+        auto ret = pthread_join(workers[index].pthread, nullptr);
+        if (ret != 0) {
+            log<log_t::EVENT_DIST_EXIT_THREAD_JOIN_FAILED>(ret);
+        }
+    }
+    started_thread_count = 0;
+}
+
+compute_stats compute_pool::get_stats(const compute_kind_t kind) const {
+    const kind_stats &kind_entry = stats[static_cast<size_t>(kind)];
+    return {
+        kind_entry.job_count.load(std::memory_order_relaxed),
+        kind_entry.queue_ns.load(std::memory_order_relaxed),
+        kind_entry.run_ns.load(std::memory_order_relaxed),
+        kind_entry.max_run_ns.load(std::memory_order_relaxed)
+    };
+}
+
+void compute_pool::log_stats() {
+    for(size_t index = 0; index < static_cast<size_t>(compute_kind_t::MAX_KIND); ++index) {
+        kind_stats &kind = stats[index];
+        const auto job_count = kind.job_count.load(std::memory_order_relaxed);
+        const auto jobs = job_count - kind.reported_job_count;
+        if (jobs == 0) continue;
+
+        const auto queue_ns = kind.queue_ns.load(std::memory_order_relaxed);
+        const auto run_ns = kind.run_ns.load(std::memory_order_relaxed);
+        log<log_t::COMPUTE_POOL_STATS>(
+            static_cast<int>(index),
+            jobs,
+            (queue_ns - kind.reported_queue_ns) / jobs,
+            (run_ns - kind.reported_run_ns) / jobs,
+            kind.max_run_ns.load(std::memory_order_relaxed));
+        kind.reported_job_count = job_count;
+        kind.reported_queue_ns = queue_ns;
+        kind.reported_run_ns = run_ns;
+    }
+}
+
+} // namespace rohit
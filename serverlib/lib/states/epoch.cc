@@ -0,0 +1,117 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <iot/states/epoch.hh>
+#include <iot/states/event_distributor.hh>
+
+namespace rohit {
+
+epoch_manager::epoch_manager(const size_t thread_count)
+    : thread_count(thread_count), entries(new thread_entry[thread_count]) { }
+
+epoch_manager::~epoch_manager() {
+    // All the loop threads are terminated by now
+    for(size_t thread_index = 0; thread_index < thread_count; ++thread_index) {
+        for(auto &retired_bucket: entries[thread_index].buckets) {
+            free_bucket(retired_bucket);
+        }
+    }
+    free_list(orphan_head.exchange(nullptr));
+}
+
+void epoch_manager::free_list(event_executor *head) {
+    int64_t count = 0;
+    while (head) {
+        auto next = head->retire_next;
+        delete head;
+        head = next;
+        ++count;
+    }
+    if (count) pending_count.fetch_sub(count, std::memory_order_relaxed);
+}
+
+void epoch_manager::free_bucket(bucket &retired_bucket) {
+    free_list(retired_bucket.head);
+    retired_bucket.head = nullptr;
+    retired_bucket.count = 0;
+}
+
+void epoch_manager::push_local(thread_entry &entry, event_executor *head, event_executor *tail, const size_t count) {
+    // Retire epoch must be current global epoch, not epoch announced by this thread
+    const uint64_t epoch = global_epoch.load(std::memory_order_seq_cst);
+    bucket &retired_bucket = entry.buckets[epoch % bucket_count];
+    if (retired_bucket.head != nullptr && retired_bucket.epoch != epoch) {
+        // Same bucket three epochs ago, it is safe to free
+        free_bucket(retired_bucket);
+    }
+
+    retired_bucket.epoch = epoch;
+    tail->retire_next = retired_bucket.head;
+    retired_bucket.head = head;
+    retired_bucket.count += count;
+}
+
+void epoch_manager::retire(const size_t thread_index, event_executor *executor) {
+    pending_count.fetch_add(1, std::memory_order_seq_cst);
+    push_local(entries[thread_index], executor, executor, 1);
+}
+
+void epoch_manager::retire_orphan(event_executor *executor) {
+    pending_count.fetch_add(1, std::memory_order_seq_cst);
+    auto head = orphan_head.load(std::memory_order_relaxed);
+    do {
+        executor->retire_next = head;
+    } while (!orphan_head.compare_exchange_weak(head, executor, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void epoch_manager::try_advance() {
+    auto epoch = global_epoch.load(std::memory_order_seq_cst);
+    for(size_t thread_index = 0; thread_index < thread_count; ++thread_index) {
+        const auto local_epoch = entries[thread_index].local_epoch.load(std::memory_order_seq_cst);
+        if (local_epoch != epoch && local_epoch != inactive_epoch) return;
+    }
+    global_epoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst);
+}
+
+void epoch_manager::quiescent(const size_t thread_index) {
+    thread_entry &entry = entries[thread_index];
+    const auto epoch = global_epoch.load(std::memory_order_seq_cst);
+    if (entry.local_epoch.load(std::memory_order_relaxed) != epoch) {
+        entry.local_epoch.store(epoch, std::memory_order_seq_cst);
+
+        for(auto &retired_bucket: entry.buckets) {
+            if (retired_bucket.head != nullptr && retired_bucket.epoch + 2 <= epoch) {
+                free_bucket(retired_bucket);
+            }
+        }
+    }
+
+    // Orphan list is taken as whole, there is no ABA
+    if (orphan_head.load(std::memory_order_relaxed) != nullptr) {
+        auto head = orphan_head.exchange(nullptr, std::memory_order_acquire);
+        if (head) {
+            auto tail = head;
+            size_t count = 1;
+            while (tail->retire_next) {
+                tail = tail->retire_next;
+                ++count;
+            }
+            push_local(entry, head, tail, count);
+        }
+    }
+
+    if (has_pending()) try_advance();
+}
+
+} // namespace rohit
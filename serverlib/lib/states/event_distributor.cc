@@ -14,51 +14,104 @@
 
 #include <iot/states/event_distributor.hh>
 #include <iot/watcher/helperevent.hh>
+#include <iot/states/compute_pool.hh>
 #include <iot/core/log.hh>
 #include <sys/epoll.h>
 #include <limits>
+#include <utility>
 #include <sys/eventfd.h>
 
 namespace rohit {
 
-event_distributor::event_distributor(const int thread_count, const int max_event_size)
-        : thread_count(thread_count), thread_entry_map(max_thread_supported), is_terminate(false) {
-    epollfd = epoll_create(max_event_size);
-
-    if (epollfd == -1) {
-        log<log_t::EVENT_DIST_CREATE_FAILED>(errno);
-        throw exception_t(err_t::EVENT_DIST_CREATE_FAILED);
-    } else {
-        log<log_t::EVENT_DIST_CREATE_SUCCESS>();
-    }
-
+event_distributor::event_distributor(
+            const int thread_count,
+            const event_mode_t mode,
+            const int max_batch_size,
+            const thread_placement &placement,
+            const int max_event_size)
+        :   mode(mode),
+            thread_count(thread_count ? thread_count : cpu_topology::get().default_thread_count(placement)),
+            max_batch_size(std::max(max_batch_size, config::event_dist_min_batch)),
+            placement_policy(placement.policy),
+            thread_cpus(cpu_topology::get().placement(placement, this->thread_count)),
+            thread_entries(new event_thread_entry[this->thread_count]), is_terminate(false),
+            epoch(this->thread_count) {
     auto cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
-    if (!thread_count) this->thread_count = cpu_count;
     if (thread_count > cpu_count) {
         log<log_t::EVENT_DIST_TOO_MANY_THREAD>();
     }
 
-    pthread_mutex_init(&eventdist_lock, nullptr);
+    shard_count = this->mode == event_mode_t::SHARDED ? this->thread_count : 1;
+    tracked_lists.reset(new tracked_list[shard_count]);
+    idle_counts.reset(new std::atomic<size_t>[shard_count]());
+
+    pthread_condattr_t condattr;
+    pthread_condattr_init(&condattr);
+    pthread_condattr_setclock(&condattr, CLOCK_MONOTONIC);
+    pthread_cond_init(&state_cond, &condattr);
+    pthread_condattr_destroy(&condattr);
+    pthread_mutex_init(&state_lock, nullptr);
+
+    for(size_t shard_index = 0; shard_index < shard_count; ++shard_index) {
+        auto epollfd = epoll_create(max_event_size);
+
+        if (epollfd == -1) {
+            log<log_t::EVENT_DIST_CREATE_FAILED>(errno);
+            for(auto createdfd: epollfds) close(createdfd);
+            throw exception_t(err_t::EVENT_DIST_CREATE_FAILED);
+        }
+        epollfds.push_back(epollfd);
+    }
+
+    if (this->mode == event_mode_t::SHARDED) {
+        log<log_t::EVENT_DIST_CREATE_SHARDED>(shard_count);
+    }
+
+    for(size_t thread_index = 0; thread_index < this->thread_count; ++thread_index) {
+        wheels.emplace_back(new timer_wheel());
+    }
+    log<log_t::EVENT_DIST_CREATE_SUCCESS>();
+}
+
+event_distributor::~event_distributor() {
+    pthread_cond_destroy(&state_cond);
+    pthread_mutex_destroy(&state_lock);
 }
 
 void event_distributor::init() {
-    pthread_t cleanup_thread;
+    cycle_clock::calibrate();
+
     auto cleanup_ret = pthread_create(&cleanup_thread, NULL, &event_distributor::cleanup, this);
     if (cleanup_ret != 0) {
         log<log_t::PTHREAD_CREATE_FAILED>(cleanup_ret);
     }
-    add_thread_map(cleanup_thread);
 
     log<log_t::EVENT_DIST_CREATING_THREAD>(this->thread_count);
     for (size_t cpu_index = 0; cpu_index < this->thread_count; ++cpu_index) {
-        pthread_t pthread;
-        auto ret = pthread_create(&pthread, NULL, &event_distributor::loop, this);
+        // Thread is pinned before it starts, so that everything it touches
+        // first is allocated on its own NUMA node
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        if (CPU_COUNT(&thread_cpus[cpu_index]) > 0) {
+            auto affinity_ret = pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &thread_cpus[cpu_index]);
+            if (affinity_ret != 0) {
+                log<log_t::EVENT_DIST_THREAD_PLACEMENT_FAILED>(cpu_index, affinity_ret);
+            }
+        }
+
+        event_thread_entry &thread_entry = thread_entries[cpu_index];
+        thread_entry.evtdist = this;
+        thread_entry.thread_index = cpu_index;
+        thread_entry.set_state(state_t::EVENT_DIST_NONE);
+
+        auto ret = pthread_create(&thread_entry.pthread, &attr, &event_distributor::loop, &thread_entry);
+        pthread_attr_destroy(&attr);
         if (ret != 0) {
             log<log_t::PTHREAD_CREATE_FAILED>(ret);
             this->thread_count = cpu_index;
             break;
         }
-        add_thread_map(pthread);
+        started_thread_count.store(cpu_index + 1, std::memory_order_release);
     }
 
     if (this->thread_count == 0) {
@@ -66,154 +119,416 @@ void event_distributor::init() {
         throw exception_t(err_t::EVENT_DIST_CREATE_FAILED);
     }
 
+    // Shards without loop thread will never be served
+    if (shard_count > 1 && shard_count > this->thread_count) {
+        shard_count = this->thread_count;
+        while (epollfds.size() > shard_count) {
+            close(epollfds.back());
+            epollfds.pop_back();
+        }
+    }
+
+    for(size_t shard_index = 0; shard_index < shard_count; ++shard_index) {
+        auto task_queue = new task_queue_executor();
+        task_queues.emplace_back(task_queue);
+        auto err = add_shard(shard_index, task_queue->get_fd(), EPOLLIN, task_queue);
+        if (isFailure(err)) {
+            throw exception_t(err);
+        }
+    }
+
     helperevent.reset(new helperevent_executor(*this));
     helperevent->init();
 }
 
+void event_distributor::init_compute(const size_t compute_thread_count) {
+    compute.reset(new compute_pool(*this, compute_thread_count));
+    compute->init();
+}
+
+void event_distributor::submit_job(event_executor *owner, compute_job *job) {
+    if (compute) {
+        compute->submit(owner, job);
+        return;
+    }
+
+    job->run();
+    job->done.store(true, std::memory_order_release);
+}
+
 thread_local thread_context ctx {};
 
-void *event_distributor::loop(void *pvoid_evtdist) {
-    event_distributor *pevtdist = static_cast<event_distributor *>(pvoid_evtdist);
-    ctx.evtdist = pevtdist;
+static inline void dispatch_event(event_thread_entry &thread_entry, const uint32_t events, event_executor *executor) {
+    const auto start = cycle_clock::now();
+    const auto type = &typeid(*executor);
+    thread_entry.spin_in_us = std::max(thread_entry.spin_in_us, executor->get_busy_poll());
+    ctx.reset_io_budget(thread_entry.evtdist->get_io_budget());
+    thread_entry.set_state(state_t::EVENT_DIST_EPOLL_PROCESSING);
+    log<log_t::EVENT_DIST_EVENT_RECEIVED>(events);
+
+    thread_entry.set_state(state_t::EVENT_DIST_EPOLL_EXECUTE);
+
+    if ((events & EPOLLHUP) == 0 && (events & EPOLLERR) != 0 && executor->has_error_queue()) {
+        // Socket error still fails next read or write
+        executor->execute_protector();
+    } else if ((events & (EPOLLHUP | EPOLLERR)) != 0) {
+        // Responsiblity of close is to free
+        executor->mark_closed(false);
+        thread_entry.set_state(state_t::EVENT_DIST_EPOLL_CLOSE);
+    } else if ((events & EPOLLRDHUP) != 0) {
+        executor->mark_closed(true);
+        thread_entry.set_state(state_t::EVENT_DIST_EPOLL_CLOSE);
+    } else {
+        executor->execute_protector();
+    }
+
+    thread_entry.record_latency(type, cycle_clock::to_ns(cycle_clock::now() - start));
+}
+
+// Idle thread waits for next timer or blocks, retire wakes it.
+// Wait is bounded while executors are pending so that epoch moves.
+static inline int loop_wait_timeout(timer_wheel &wheel, const bool idle) {
+    const auto timeout = wheel.next_timeout_in_ms();
+    if (idle) return timeout;
+    if (timeout < 0) return config::event_epoch_wait_in_ms;
+    return std::min<int>(timeout, config::event_epoch_wait_in_ms);
+}
+
+// Returns true if poll found something before spin budget expired
+template <typename POLL>
+static inline bool busy_poll(const int spin_in_us, POLL poll) {
+    if (spin_in_us <= 0) return false;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(spin_in_us);
+    do {
+        if (poll()) return true;
+    } while (std::chrono::steady_clock::now() < deadline);
+    return false;
+}
 
-    while(pevtdist->thread_entry_map.find(pthread_self()) == pevtdist->thread_entry_map.end()) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(config::event_dist_loop_wait_in_millis));
+// Loop thread returns once this is true, events of last wait are dropped
+static inline bool loop_terminated(event_distributor *pevtdist, event_thread_entry &thread_entry) {
+    if (!pevtdist->isTerminated()) return false;
+    thread_entry.set_state(state_t::EVENT_DIST_EPOLL_TERMINATE);
+    return true;
+}
+
+// Returns true if loop must exit
+static inline bool wait_interrupted(event_distributor *pevtdist, event_thread_entry &thread_entry, const int error) {
+    if (error == EINTR) return loop_terminated(pevtdist, thread_entry);
+
+    log<log_t::EVENT_DIST_LOOP_WAIT_INTERRUPTED>(error);
+    sleep(1);
+    return loop_terminated(pevtdist, thread_entry);
+}
+
+// Executors deferred while this list runs wait for next batch
+void event_distributor::run_ready(event_distributor *pevtdist, event_thread_entry &thread_entry) {
+    if (thread_entry.ready.empty()) return;
+    thread_entry.ready_running.swap(thread_entry.ready);
+    for(auto executor: thread_entry.ready_running) {
+        const auto start = cycle_clock::now();
+        const auto type = &typeid(*executor);
+        executor->ready_queued.store(false, std::memory_order_release);
+        thread_entry.spin_in_us = std::max(thread_entry.spin_in_us, executor->get_busy_poll());
+        ctx.reset_io_budget(pevtdist->get_io_budget());
+        thread_entry.set_state(state_t::EVENT_DIST_EPOLL_EXECUTE);
+        executor->execute_protector();
+        thread_entry.record_latency(type, cycle_clock::to_ns(cycle_clock::now() - start));
+        pevtdist->release_hold(executor);
+    }
+    thread_entry.ready_running.clear();
+}
+
+// Loop is exiting, deferred executors are not executed again
+void event_distributor::release_ready(event_distributor *pevtdist, event_thread_entry &thread_entry) {
+    for(auto executor: thread_entry.ready) {
+        executor->ready_queued.store(false, std::memory_order_release);
+        pevtdist->release_hold(executor);
+    }
+    thread_entry.ready.clear();
+}
+
+void *event_distributor::loop(void *pvoid_thread_entry) {
+    event_thread_entry &thread_entry = *static_cast<event_thread_entry *>(pvoid_thread_entry);
+    event_distributor *pevtdist = thread_entry.evtdist;
+    ctx.evtdist = pevtdist;
+    ctx.thread_index = thread_entry.thread_index;
+
+    if (pevtdist->placement_policy != thread_placement_t::NONE) {
+        // Thread local buffers and timer wheel are first touched by creating thread
+        const int node = current_numa_node();
+        move_to_numa_node(&ctx, sizeof(ctx), node);
+        move_to_numa_node(pevtdist->wheels[ctx.thread_index].get(), sizeof(timer_wheel), node);
+        log<log_t::EVENT_DIST_THREAD_PLACED>(ctx.thread_index, sched_getcpu(), node);
     }
-    event_thread_entry &thread_entry = pevtdist->thread_entry_map[pthread_self()];
 
     // This is infinite loop
     log<log_t::EVENT_DIST_LOOP_CREATED>();
 
-    epoll_event events[event_wait_count];
+    loop_epoll(pevtdist, thread_entry);
+    release_ready(pevtdist, thread_entry);
+
+    return nullptr;
+} // void *event_distributor::loop
+
+void event_distributor::loop_epoll(event_distributor *pevtdist, event_thread_entry &thread_entry) {
+    const auto shard_index = pevtdist->current_shard();
+    const int epollfd = pevtdist->epollfds[shard_index];
+    timer_wheel &wheel = *pevtdist->wheels[ctx.thread_index];
+
+    std::vector<epoll_event> events(pevtdist->max_batch_size);
     while(true) {
-        thread_entry.set_state(state_t::EVENT_DIST_EPOLL_WAIT);
-        auto ret = epoll_wait(pevtdist->epollfd, events, event_wait_count, -1);
+        // Executors received from this wait belong to announced epoch
+        pevtdist->epoch.quiescent(ctx.thread_index);
 
-        if (ret == -1) {
-            if (errno == EINTR || errno == EINVAL) {
-                if (pevtdist->is_terminate) {
-                    thread_entry.set_state(state_t::EVENT_DIST_EPOLL_TERMINATE);
-                    pthread_exit(nullptr);
-                }
+        thread_entry.set_state(state_t::EVENT_DIST_EPOLL_WAIT);
+        int ret = 0;
+        if (!thread_entry.ready.empty()) {
+            // Deferred executors are waiting, only pick up what is ready
+            ret = epoll_wait(epollfd, events.data(), thread_entry.batch_size, 0);
+        } else {
+            // Spin only after serving executor that asked for it, thread
+            // keeps spinning while such executors keep getting events
+            const int spin_in_us = std::exchange(thread_entry.spin_in_us, 0);
+            const bool polled = busy_poll(spin_in_us, [&]() {
+                ret = epoll_wait(epollfd, events.data(), thread_entry.batch_size, 0);
+                return ret != 0;
+            });
+            if (!polled) {
+                const bool idle = pevtdist->enter_idle(shard_index);
+                ret = epoll_wait(epollfd, events.data(), thread_entry.batch_size, loop_wait_timeout(wheel, idle));
+                if (idle) pevtdist->leave_idle(shard_index);
             }
+        }
 
-            log<log_t::EVENT_DIST_LOOP_WAIT_INTERRUPTED>(errno);
-            sleep(1);
-            // Check again if terminated
-            if (pevtdist->is_terminate) {
-                thread_entry.set_state(state_t::EVENT_DIST_EPOLL_TERMINATE);
-                pthread_exit(nullptr);
-            }
+        if (ret == -1) {
+            if (wait_interrupted(pevtdist, thread_entry, errno)) return;
             continue;
         }
 
-        for(decltype(ret) index = 0; index < ret; ++index) {
-            thread_entry.set_state(state_t::EVENT_DIST_EPOLL_PROCESSING);
-
-            epoll_event &event = events[index];
-            log<log_t::EVENT_DIST_EVENT_RECEIVED>(event.events);
+        if (loop_terminated(pevtdist, thread_entry)) return;
 
-            event_executor *executor = (event_executor *)(event.data.ptr);
-            thread_entry.set_state(state_t::EVENT_DIST_EPOLL_EXECUTE);
+        wheel.advance();
 
-            if ((event.events & (EPOLLHUP | EPOLLERR)) != 0) {
-                // Responsiblity of close is to free
-                executor->mark_closed(false);
-                thread_entry.set_state(state_t::EVENT_DIST_EPOLL_CLOSE);
-            } else if ((event.events & EPOLLRDHUP) != 0) {
-                executor->mark_closed(true);
-                thread_entry.set_state(state_t::EVENT_DIST_EPOLL_CLOSE);
-            } else {
-                executor->execute_protector();
+        if (ret > 0) {
+            thread_entry.update_batch(ret, pevtdist->max_batch_size);
+            for(decltype(ret) index = 0; index < ret; ++index) {
+                epoll_event &event = events[index];
+                dispatch_event(thread_entry, event.events, (event_executor *)(event.data.ptr));
             }
         }
+        run_ready(pevtdist, thread_entry);
     }
-
-    return nullptr;
-} // void *event_distributor::loop
+} // void event_distributor::loop_epoll
 
 void *event_distributor::cleanup(void *pvoid_evtdist) {
     event_distributor *pevtdist = static_cast<event_distributor *>(pvoid_evtdist);
     ctx.evtdist = pevtdist;
 
-    while(!pevtdist->is_terminate) {
-        // Cleaning up logs
-        pthread_mutex_lock(&pevtdist->eventdist_lock);
-        while (!pevtdist->cleanup_queue.empty() && pevtdist->cleanup_queue.front().to_free()) {
-            pevtdist->cleanup_queue.front().remove_and_free(pevtdist->closed_received);
-            pevtdist->cleanup_queue.pop();
-        }
-        pthread_mutex_unlock(&pevtdist->eventdist_lock);
+    while(!pevtdist->isTerminated()) {
+        const auto current_time = coarse_now_ns();
+        const auto thread_count = pevtdist->started_thread_count.load(std::memory_order_acquire);
+        for(size_t thread_index = 0; thread_index < thread_count; ++thread_index) {
+            event_thread_entry &thread_entry = pevtdist->thread_entries[thread_index];
+
+            if constexpr (config::event_dist_log_stats) {
+                // Events per wakeup since last report
+                const auto wakeup_count = thread_entry.wakeup_count;
+                const auto event_count = thread_entry.event_count;
+                log<log_t::EVENT_DIST_BATCH_STATS>(
+                    thread_index,
+                    wakeup_count - thread_entry.reported_wakeup_count,
+                    event_count - thread_entry.reported_event_count,
+                    thread_entry.batch_size);
+                thread_entry.reported_wakeup_count = wakeup_count;
+                thread_entry.reported_event_count = event_count;
+
+                const auto latency = pevtdist->get_thread_latency(thread_index);
+                log<log_t::EVENT_DIST_LATENCY_STATS>(
+                    thread_index, latency.count, latency.percentile(50), latency.percentile(99), latency.max_ns);
+            }
 
-        uint64_t current_time = std::chrono::system_clock::now().time_since_epoch().count();
-        for(auto thread_entry: pevtdist->thread_entry_map) {
-            if (thread_entry.second.pthread != pthread_self() && 
-                thread_entry.second.state != state_t::EVENT_DIST_EPOLL_WAIT &&
-                current_time - thread_entry.second.timestamp >= config::event_dist_deadlock_in_nanos)
+            const auto state = thread_entry.state;
+            const auto timestamp = thread_entry.timestamp;
+            if (state != state_t::EVENT_DIST_EPOLL_WAIT &&
+                state != state_t::EVENT_DIST_NONE &&
+                current_time - timestamp >= config::event_dist_deadlock_in_nanos)
             {
-                log<log_t::EVENT_DIST_DEADLOCK_DETECTED>(thread_entry.second.pthread, thread_entry.second.state);
+                log<log_t::EVENT_DIST_DEADLOCK_DETECTED>(thread_index, state);
             }
         }
 
-        std::this_thread::sleep_for(std::chrono::nanoseconds(cleanup_loop_time_in_ns));
-    }
+        if (pevtdist->compute) pevtdist->compute->log_stats();
 
-    while (!pevtdist->cleanup_queue.empty()) {
-        pevtdist->cleanup_queue.front().remove_and_free(pevtdist->closed_received);
-        pevtdist->cleanup_queue.pop();
+        // Terminate wakes this up
+        timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += cleanup_loop_time_in_ns / 1000000000ULL;
+        pthread_mutex_lock(&pevtdist->state_lock);
+        if (!pevtdist->isTerminated()) {
+            pthread_cond_timedwait(&pevtdist->state_cond, &pevtdist->state_lock, &deadline);
+        }
+        pthread_mutex_unlock(&pevtdist->state_lock);
     }
 
-    return nullptr;    
+    return nullptr;
 } // void *event_distributor::cleanup
 
+latency_snapshot event_distributor::get_thread_latency(const size_t thread_index) const {
+    latency_snapshot snapshot { };
+    const event_thread_entry &thread_entry = thread_entries[thread_index];
+    for(size_t index = 0; index < config::event_dist_latency_type_count; ++index) {
+        const auto &slot = thread_entry.latency_slots[index];
+        if (slot.type.load(std::memory_order_acquire) != nullptr) snapshot.add(slot.histogram);
+    }
+    snapshot.add(thread_entry.latency_overflow);
+    return snapshot;
+}
+
+std::vector<latency_report> event_distributor::get_latency_reports() const {
+    std::vector<latency_report> reports;
+    auto find_report = [&reports](const std::type_info *type) -> latency_snapshot & {
+        for(auto &report: reports) {
+            if (report.type == type) return report.snapshot;
+        }
+        reports.push_back({ type, { } });
+        return reports.back().snapshot;
+    };
+
+    const auto thread_count = started_thread_count.load(std::memory_order_acquire);
+    for(size_t thread_index = 0; thread_index < thread_count; ++thread_index) {
+        const event_thread_entry &thread_entry = thread_entries[thread_index];
+        for(size_t index = 0; index < config::event_dist_latency_type_count; ++index) {
+            const auto &slot = thread_entry.latency_slots[index];
+            const auto type = slot.type.load(std::memory_order_acquire);
+            if (type != nullptr) find_report(type).add(slot.histogram);
+        }
+        if (thread_entry.latency_overflow.get_count() != 0) find_report(nullptr).add(thread_entry.latency_overflow);
+    }
+    return reports;
+}
+
 void event_distributor::wait() {
-    for (auto thread_entry: thread_entry_map) {
-        auto ret = pthread_join(thread_entry.second.pthread, nullptr);
+    std::vector<pthread_t> pthreads { cleanup_thread };
+    const auto thread_count = started_thread_count.load(std::memory_order_acquire);
+    for(size_t thread_index = 0; thread_index < thread_count; ++thread_index) {
+        pthreads.push_back(thread_entries[thread_index].pthread);
+    }
+
+    for (auto pthread: pthreads) {
+        auto ret = pthread_join(pthread, nullptr);
         if (ret != 0) {
             log<log_t::EVENT_DIST_EXIT_THREAD_JOIN_FAILED>(ret);
         } else {
             log<log_t::EVENT_DIST_EXIT_THREAD_JOIN_SUCCESS>();
         }
-    }   
+    }
+
+    // Completion of jobs finished after loop threads exit is dropped
+    if (compute) compute->join();
+
+    // No loop thread is waiting on these anymore
+    for(auto epollfd: epollfds) {
+        auto ret = close(epollfd);
+        if (ret != 0) {
+            log<log_t::EVENT_DIST_EXIT_EPOLL_CLOSE_FAILED>(ret);
+        }
+    }
+    epollfds.clear();
+    if (terminatefd != -1) {
+        close(terminatefd);
+        terminatefd = -1;
+    }
+}
+
+void event_distributor::notify_state() {
+    pthread_mutex_lock(&state_lock);
+    pthread_cond_broadcast(&state_cond);
+    pthread_mutex_unlock(&state_lock);
+}
+
+bool event_distributor::wait_drained(const int timeout_in_ms) {
+    timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_in_ms / 1000;
+    deadline.tv_nsec += (timeout_in_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        ++deadline.tv_sec;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&state_lock);
+    while(tracked_count.load(std::memory_order_acquire) != 0) {
+        if (pthread_cond_timedwait(&state_cond, &state_lock, &deadline) == ETIMEDOUT) break;
+    }
+    pthread_mutex_unlock(&state_lock);
+    return tracked_count.load(std::memory_order_acquire) == 0;
+}
+
+// Runs as task on loop thread of shard, so executors in list
+// cannot be freed while this is running even if they close
+void event_distributor::drain_shard(const size_t shard_index, const bool force) {
+    std::vector<event_executor *> executors { };
+    auto &list = tracked_lists[shard_index];
+    list.lock();
+    for(auto executor = list.head; executor; executor = executor->tracked_next) {
+        executors.push_back(executor);
+    }
+    list.unlock();
+
+    for(auto executor: executors) {
+        if (force) {
+            executor->mark_closed(false);
+            untrack(executor);
+        } else {
+            executor->drain_protector();
+        }
+    }
 }
 
-class terminate_executor : public event_executor {
-private:
-    event_distributor &evtdist;
-    int terminatefd;
-public:
-    terminate_executor(event_distributor &evtdist, int terminatefd)
-        : evtdist(evtdist), terminatefd(terminatefd) {
+bool event_distributor::drain(const int timeout_in_ms) {
+    if (ctx_is_loop_thread()) {
+        log<log_t::EVENT_DIST_DRAIN_FROM_LOOP_THREAD>();
+        return false;
     }
 
-private:
-    void execute() override {
-        pthread_exit(nullptr);
+    log<log_t::EVENT_DIST_DRAINING>(get_tracked_count(), timeout_in_ms);
+    is_draining.store(true, std::memory_order_release);
+    for(size_t shard_index = 0; shard_index < shard_count; ++shard_index) {
+        post_to_shard(shard_index, [this, shard_index]() { drain_shard(shard_index, false); });
     }
 
-    void flush() override { }
+    if (wait_drained(timeout_in_ms)) {
+        log<log_t::EVENT_DIST_DRAINED>();
+        return true;
+    }
 
-    void close() override {
-        ctx.delayed_free(this);
+    log<log_t::EVENT_DIST_DRAIN_TIMEOUT>(get_tracked_count());
+    for(size_t shard_index = 0; shard_index < shard_count; ++shard_index) {
+        post_to_shard(shard_index, [this, shard_index]() { drain_shard(shard_index, true); });
     }
-};
+    wait_drained(config::event_dist_force_close_wait_in_ms);
+    return false;
+}
 
 void event_distributor::terminate() {
+    if (is_terminate.exchange(true, std::memory_order_acq_rel)) return;
     log<log_t::EVENT_DIST_TERMINATING>();
-    is_terminate = true;
 
-    for(decltype(thread_count) thread_index = 0; thread_index < thread_count; ++thread_index) {
-        auto tempfd = eventfd(1, EFD_SEMAPHORE);
-        terminate_executor termateexecutor(*this, tempfd);
-        add(tempfd, EPOLLIN, &termateexecutor);
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
-        close(tempfd);
+    // Never read, so it stays readable and wakes every waiting thread
+    terminatefd = eventfd(1, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (terminatefd == -1) {
+        log<log_t::EVENT_DIST_TERMINATE_EVENT_FAILED>(errno);
+    } else {
+        for(size_t shard_index = 0; shard_index < shard_count; ++shard_index) {
+            register_shard(shard_index, terminatefd, EPOLLIN, &terminator);
+        }
     }
 
-    auto ret = close(epollfd);
-    if (ret != 0) {
-        log<log_t::EVENT_DIST_EXIT_EPOLL_CLOSE_FAILED>(ret);
-    }
+    if (compute) compute->stop();
+
+    // Wakes up cleanup thread
+    notify_state();
 }
 
 bool event_distributor::pause() {
@@ -0,0 +1,192 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <iot/states/timer_wheel.hh>
+#include <iot/states/event_distributor.hh>
+#include <algorithm>
+#include <bit>
+
+namespace rohit {
+
+timer_wheel::timer_wheel() : current_tick(now_tick()) {
+    size_t index = 0;
+    for(; index < max_wheel_count; ++index) {
+        timer_wheel *expected = nullptr;
+        if (wheel_registry[index].compare_exchange_strong(expected, this, std::memory_order_acq_rel)) break;
+    }
+    if (index == max_wheel_count) throw exception_t(err_t::TIMER_WHEEL_LIMIT_REACHED);
+    id = static_cast<uint16_t>(index + 1);
+    pthread_mutex_init(&lock, nullptr);
+}
+
+timer_wheel::~timer_wheel() {
+    pthread_mutex_destroy(&lock);
+    wheel_registry[id - 1].store(nullptr, std::memory_order_release);
+}
+
+// Expiry is within 2^31 ticks of current tick either way
+inline uint64_t timer_wheel::expiry_of(const event_timer &timer) const {
+    const int32_t delta = static_cast<int32_t>(timer.expiry_tick - static_cast<uint32_t>(current_tick));
+    return current_tick + delta;
+}
+
+inline void timer_wheel::insert(event_timer &timer) {
+    const uint64_t expiry_tick = expiry_of(timer);
+    uint64_t delta = expiry_tick > current_tick ? expiry_tick - current_tick : 0;
+    size_t level = 0;
+    uint64_t slot_tick = expiry_tick;
+    if (delta >= max_delta) {
+        // Parked in last level, it will be cascaded again
+        level = level_count - 1;
+        slot_tick = current_tick + max_delta - 1;
+    } else {
+        while (delta >= slot_count) {
+            delta >>= level_bits;
+            ++level;
+        }
+    }
+
+    const size_t slot = (slot_tick >> (level_bits * level)) & slot_mask;
+    event_timer *&head = slots[level][slot];
+    timer.next = head;
+    if (head) head->pprev = &timer.next;
+    timer.pprev = &head;
+    head = &timer;
+    timer.slot_index = static_cast<uint16_t>(level * slot_count + slot);
+    occupied[level] |= 1ULL << slot;
+}
+
+inline void timer_wheel::unlink(event_timer &timer) {
+    *timer.pprev = timer.next;
+    if (timer.next) timer.next->pprev = timer.pprev;
+
+    const size_t level = timer.slot_index / slot_count;
+    const size_t slot = timer.slot_index % slot_count;
+    if (slots[level][slot] == nullptr) occupied[level] &= ~(1ULL << slot);
+
+    timer.next = nullptr;
+    timer.pprev = nullptr;
+}
+
+inline void timer_wheel::cascade(const size_t level) {
+    const size_t slot = (current_tick >> (level_bits * level)) & slot_mask;
+    event_timer *timer = slots[level][slot];
+    slots[level][slot] = nullptr;
+    occupied[level] &= ~(1ULL << slot);
+
+    while (timer) {
+        auto next = timer->next;
+        insert(*timer);
+        timer = next;
+    }
+}
+
+void timer_wheel::arm(event_timer &timer, const uint64_t timeout_in_ms) {
+    if (timer.wheel_id != 0 && timer.wheel_id != id) disarm(timer);
+
+    const uint64_t timeout_tick = std::clamp<uint64_t>((timeout_in_ms + config::timer_tick_in_ms - 1) / config::timer_tick_in_ms, 1, max_timeout_tick - 1);
+
+    pthread_mutex_lock(&lock);
+    if (timer.wheel_id != id) {
+        timer.wheel_id = id;
+        ++timer_count;
+    } else if (timer.slot_index != firing_slot) {
+        unlink(timer);
+    }
+    timer.expiry_tick = static_cast<uint32_t>(current_tick + timeout_tick);
+    insert(timer);
+    pthread_mutex_unlock(&lock);
+}
+
+void timer_wheel::cancel(event_timer &timer) {
+    pthread_mutex_lock(&lock);
+    if (timer.wheel_id == id) {
+        if (timer.slot_index != firing_slot) unlink(timer);
+        timer.wheel_id = 0;
+        --timer_count;
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+void timer_wheel::advance() {
+    const uint64_t target_tick = now_tick();
+
+    pthread_mutex_lock(&lock);
+    while (current_tick < target_tick) {
+        if (timer_count == 0) {
+            current_tick = target_tick;
+            break;
+        }
+
+        ++current_tick;
+        for(size_t level = 1; level < level_count; ++level) {
+            if ((current_tick & ((1ULL << (level_bits * level)) - 1)) != 0) break;
+            cascade(level);
+        }
+
+        // Lock is released while firing, timer callback can arm timers
+        // arm is always at least one tick later, so it never lands in current slot
+        event_timer *&head = slots[0][current_tick & slot_mask];
+        while (head) {
+            event_timer &timer = *head;
+            unlink(timer);
+            timer.slot_index = firing_slot;
+            pthread_mutex_unlock(&lock);
+
+            // Executor memory is reclaimed by epoch, it is valid till
+            // this loop iteration ends even if executor closes meanwhile
+            const bool fired = timer.executor->timeout_protector(&timer);
+
+            pthread_mutex_lock(&lock);
+            if (timer.wheel_id != id || timer.slot_index != firing_slot) {
+                // Cancelled or armed again from timeout or busy executor
+                continue;
+            }
+            if (fired) {
+                timer.wheel_id = 0;
+                --timer_count;
+            } else {
+                // Executor was busy in other thread, timeout is retried
+                timer.expiry_tick = static_cast<uint32_t>(current_tick + 1);
+                insert(timer);
+            }
+        }
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+int timer_wheel::next_timeout_in_ms() {
+    pthread_mutex_lock(&lock);
+    if (timer_count == 0) {
+        pthread_mutex_unlock(&lock);
+        return -1;
+    }
+
+    // Next occupied slot of level 0 or next cascade whichever is earlier
+    uint64_t wait_tick = slot_count - (current_tick & slot_mask);
+    if (occupied[0]) {
+        const size_t start = (current_tick + 1) & slot_mask;
+        const uint64_t rotated = std::rotr(occupied[0], static_cast<int>(start));
+        wait_tick = std::min<uint64_t>(wait_tick, std::countr_zero(rotated) + 1);
+    }
+    const uint64_t expiry_tick = current_tick + wait_tick;
+    pthread_mutex_unlock(&lock);
+
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    const uint64_t now_in_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+    const uint64_t expiry_in_ms = expiry_tick * config::timer_tick_in_ms;
+    return expiry_in_ms > now_in_ms ? static_cast<int>(expiry_in_ms - now_in_ms) : 0;
+}
+
+} // namespace rohit
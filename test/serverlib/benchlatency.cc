@@ -0,0 +1,119 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+// Command round trip latency of event loop with and without busy poll
+// Usage: ServerLibraryBenchLatency [round_trip_count] [busy_poll_in_us]
+
+#include <iot/states/event_distributor.hh>
+#include <iot/watcher/helperevent.hh>
+#include <iot/net/serverevent.hh>
+#include <iot/init.hh>
+#include <algorithm>
+#include <iostream>
+#include <string.h>
+#include <vector>
+
+class echo_event : public rohit::serverpeerevent<false> {
+public:
+    static constexpr bool movable = false;
+
+    echo_event(rohit::socket_t &peer_id) : rohit::serverpeerevent<false>(peer_id) { }
+
+    void execute() override {
+        size_t read_len = 0;
+        auto err = peer_id.read(rohit::ctx.read_buffer, rohit::ctx.buffer_size, read_len);
+        if (err != rohit::err_t::SUCCESS || read_len == 0) return;
+
+        size_t written = 0;
+        peer_id.write(rohit::ctx.read_buffer, read_len, written);
+    }
+};
+
+struct latency_result {
+    uint64_t p50;
+    uint64_t p99;
+    uint64_t p999;
+    uint64_t max;
+};
+
+latency_result measure(const int port, const size_t round_trip_count) {
+    rohit::client_socket_t client(rohit::ipv6_socket_addr_t("::1", port));
+    std::vector<uint64_t> latencies;
+    latencies.reserve(round_trip_count);
+
+    uint8_t command[64];
+    memset(command, 0xa5, sizeof(command));
+    uint8_t response[64];
+    for(size_t index = 0; index < round_trip_count; ++index) {
+        const auto start = std::chrono::steady_clock::now();
+        size_t written = 0;
+        client.write(command, sizeof(command), written);
+        size_t received = 0;
+        while (received < sizeof(command)) {
+            size_t read_len = 0;
+            if (client.read(response + received, sizeof(response) - received, read_len) != rohit::err_t::SUCCESS || read_len == 0) {
+                throw rohit::exception_t(rohit::err_t::RECEIVE_FAILURE);
+            }
+            received += read_len;
+        }
+        const auto end = std::chrono::steady_clock::now();
+        latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    }
+    client.close();
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](const double value) {
+        return latencies[std::min(latencies.size() - 1, static_cast<size_t>(value * latencies.size()))];
+    };
+    return { percentile(0.50), percentile(0.99), percentile(0.999), latencies.back() };
+}
+
+latency_result run(const int port, const size_t round_trip_count, const int busy_poll_in_us) {
+    rohit::event_distributor evtdist(1, rohit::event_mode_t::SHARDED);
+    evtdist.init();
+
+    rohit::serverevent<echo_event, false> server(port, 100, true);
+    server.set_busy_poll(busy_poll_in_us);
+    server.init(evtdist);
+
+    // Warm up connection path before measuring
+    measure(port, round_trip_count / 10 + 1);
+    auto result = measure(port, round_trip_count);
+
+    evtdist.terminate();
+    evtdist.wait();
+    server.close();
+    return result;
+}
+
+void print(const char *name, const latency_result &result) {
+    std::cout << name
+        << " p50 " << result.p50 / 1000.0 << "us"
+        << ", p99 " << result.p99 / 1000.0 << "us"
+        << ", p99.9 " << result.p999 / 1000.0 << "us"
+        << ", max " << result.max / 1000.0 << "us" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    const size_t round_trip_count = argc > 1 ? std::stoul(argv[1]) : 100000;
+    const int busy_poll_in_us = argc > 2 ? std::stoi(argv[2]) : 50;
+
+    rohit::init_iot("/tmp/iotcloud_benchlatency.log");
+    std::cout << "Round trips: " << round_trip_count << ", busy poll: " << busy_poll_in_us << "us" << std::endl;
+    print("Blocking  ", run(18301, round_trip_count, 0));
+    print("Busy poll ", run(18302, round_trip_count, busy_poll_in_us));
+    rohit::destroy_iot();
+
+    return 0;
+}
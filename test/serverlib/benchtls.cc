@@ -0,0 +1,158 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+// TLS file download throughput with userspace TLS and with kTLS
+// Usage: ServerLibraryBenchTLS [cert_file] [body_size_in_kb] [request_count]
+// kTLS needs tls kernel module (modprobe tls), without it both runs use userspace TLS
+
+#include <iot/states/event_distributor.hh>
+#include <iot/net/serverevent.hh>
+#include <iot/init.hh>
+#include <atomic>
+#include <iostream>
+#include <string.h>
+#include <sys/mman.h>
+#include <vector>
+
+int body_fd = -1;
+size_t body_size = 0;
+rohit::io_buffer *body = nullptr;
+std::shared_ptr<const void> body_owner { std::make_shared<int>(0) };
+std::atomic<bool> ktls_active { false };
+
+// Every byte received is a request for whole body
+class file_peer : public rohit::serverpeerevent<true> {
+public:
+    static constexpr bool movable = false;
+    using rohit::serverpeerevent<true>::serverpeerevent;
+
+protected:
+    void request() {
+        if (peer_id.can_sendfile()) {
+            ktls_active = true;
+            push_write_file(body_fd, body_size, body_owner);
+        } else {
+            // Shared body as HTTP GET does without sendfile
+            push_write(body->share(), body_size);
+        }
+    }
+
+    void execute() override {
+        switch (client_state) {
+        case rohit::state_t::SOCKET_PEER_ACCEPT: {
+            auto err = peer_id.accept();
+            if (err == rohit::err_t::SUCCESS) client_state = rohit::state_t::SOCKET_PEER_EVENT;
+            else if (err != rohit::err_t::SOCKET_RETRY) close();
+            return;
+        }
+        case rohit::state_t::SOCKET_PEER_CLOSE:
+        case rohit::state_t::SOCKET_PEER_CLOSED:
+            close();
+            return;
+        case rohit::state_t::SOCKET_PEER_WRITE:
+            write_all();
+            if (client_state == rohit::state_t::SOCKET_PEER_WRITE) return;
+            break;
+        default:
+            break;
+        }
+
+        uint8_t buffer[64];
+        size_t read_len = 0;
+        auto err = peer_id.read(buffer, sizeof(buffer), read_len);
+        if (err == rohit::err_t::SOCKET_RETRY) return;
+        if (err != rohit::err_t::SUCCESS || read_len == 0) {
+            close();
+            return;
+        }
+        for(size_t index = 0; index < read_len; ++index) request();
+        write_all();
+    }
+};
+
+double measure(const int port, const size_t request_count) {
+    SSL_CTX *client_ctx = SSL_CTX_new(TLS_client_method());
+    rohit::client_socket_t client(rohit::ipv6_socket_addr_t("::1", port));
+    SSL *ssl = SSL_new(client_ctx);
+    SSL_set_fd(ssl, client);
+    if (SSL_connect(ssl) <= 0) throw rohit::exception_t(rohit::err_t::SSL_CONNECT_FAILED);
+
+    std::vector<uint8_t> response(256 * 1024);
+    const auto start = std::chrono::steady_clock::now();
+    for(size_t index = 0; index < request_count; ++index) {
+        const uint8_t command = 'G';
+        SSL_write(ssl, &command, 1);
+        size_t received = 0;
+        while (received < body_size) {
+            auto ret = SSL_read(ssl, response.data(), std::min(response.size(), body_size - received));
+            if (ret <= 0) throw rohit::exception_t(rohit::err_t::RECEIVE_FAILURE);
+            received += ret;
+        }
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    SSL_shutdown(ssl);
+    SSL_free(ssl);
+    client.close();
+    SSL_CTX_free(client_ctx);
+
+    const double seconds = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / 1e9;
+    return static_cast<double>(body_size) * request_count / seconds / (1024.0 * 1024.0);
+}
+
+double run(const int port, const char *cert_file, const size_t request_count, const bool ktls) {
+    rohit::event_distributor evtdist(1);
+    evtdist.init();
+
+    rohit::serverevent<file_peer, true> server(port, cert_file, cert_file, 100);
+    server.set_ktls(ktls);
+    server.init(evtdist);
+
+    ktls_active = false;
+    measure(port, request_count / 10 + 1);
+    auto result = measure(port, request_count);
+
+    evtdist.terminate();
+    evtdist.wait();
+    server.close();
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    const char *cert_file = argc > 1 ? argv[1] : "../../resources/key/testcert.pem";
+    body_size = (argc > 2 ? std::stoul(argv[2]) : 4096) * 1024;
+    const size_t request_count = argc > 3 ? std::stoul(argv[3]) : 50;
+
+    // Body is served from memfd as web file cache does
+    body = rohit::io_buffer::alloc(body_size);
+    for(size_t index = 0; index < body_size; ++index) body->data()[index] = static_cast<uint8_t>(index * 7);
+    body_fd = memfd_create("benchtls", MFD_CLOEXEC);
+    if (::write(body_fd, body->data(), body_size) != static_cast<ssize_t>(body_size)) return 1;
+
+    rohit::init_iot("/tmp/iotcloud_benchtls.log");
+    std::cout << "Body: " << body_size / 1024 << "KB, requests: " << request_count << std::endl;
+
+    const auto userspace = run(18401, cert_file, request_count, false);
+    std::cout << "Userspace TLS " << userspace << "MB/s" << std::endl;
+
+    const auto kernel = run(18402, cert_file, request_count, true);
+    std::cout << "kTLS          " << kernel << "MB/s"
+        << (ktls_active ? "" : " (kernel TLS not available, userspace fallback)") << std::endl;
+
+    rohit::destroy_iot();
+    body->release();
+    ::close(body_fd);
+
+    return 0;
+}
@@ -0,0 +1,36 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <iostream>
+#include <stdint.h>
+
+// Shared by serverlib tests, main ends with return test_summary()
+inline uint16_t success = 0;
+inline uint16_t failure = 0;
+
+inline void check(const bool condition, const char *name) {
+    if (condition) {
+        ++success;
+    } else {
+        ++failure;
+        std::cout << "Failed: " << name << std::endl;
+    }
+}
+
+inline int test_summary() {
+    std::cout << "Summary: success(" << success << "), failure(" << failure << ")" << std::endl;
+    return failure == 0 ? 0 : 1;
+}
@@ -0,0 +1,193 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <iot/net/serverevent.hh>
+#include <iot/watcher/helperevent.hh>
+#include <iot/init.hh>
+#include <testcheck.hh>
+#include <iostream>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <thread>
+#include <vector>
+
+template <typename PRED>
+bool wait_for(PRED pred) {
+    for(int count = 0; count < 500; ++count) {
+        if (pred()) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return pred();
+}
+
+constexpr int port = 18601;
+constexpr size_t client_count = 20;
+
+struct accepted_peer {
+    rohit::ipv6_socket_addr_t peer_addr;
+    rohit::ipv6_socket_addr_t local_addr;
+    bool non_blocking;
+    bool close_on_exec;
+    int busy_poll;
+};
+
+rohit::pthread_lock_c<true> accepted_lock;
+std::vector<accepted_peer> accepted;
+
+// Records what accept captured on first execute
+class record_peer : public rohit::serverpeerevent<false> {
+public:
+    static constexpr bool movable = false;
+    using rohit::serverpeerevent<false>::serverpeerevent;
+
+protected:
+    bool recorded { false };
+
+    void execute() override {
+        if (client_state == rohit::state_t::SOCKET_PEER_CLOSE) {
+            close();
+            return;
+        }
+        if (recorded) return;
+        recorded = true;
+
+        const int fd = peer_id;
+        accepted_peer peer {
+            get_peer_addr(),
+            get_local_addr(),
+            (fcntl(fd, F_GETFL) & O_NONBLOCK) != 0,
+            (fcntl(fd, F_GETFD) & FD_CLOEXEC) != 0,
+            get_busy_poll() };
+        accepted_lock.lock();
+        accepted.push_back(peer);
+        accepted_lock.unlock();
+    }
+};
+
+bool same_addr(const rohit::ipv6_socket_addr_t &first, const rohit::ipv6_socket_addr_t &second) {
+    return memcmp(&first, &second, sizeof(first)) == 0;
+}
+
+void test_accept(const rohit::event_mode_t mode, const int busy_poll_in_us = 0) {
+    accepted.clear();
+    rohit::event_distributor evtdist(2, mode);
+    evtdist.init();
+    rohit::serverevent<record_peer, false> server(port, 100);
+    server.set_busy_poll(busy_poll_in_us);
+    server.init(evtdist);
+
+    std::vector<std::unique_ptr<rohit::client_socket_t>> clients;
+    for(size_t index = 0; index < client_count; ++index) {
+        clients.emplace_back(new rohit::client_socket_t(rohit::ipv6_socket_addr_t("::1", port)));
+    }
+    check(wait_for([&] {
+        accepted_lock.lock();
+        const auto count = accepted.size();
+        accepted_lock.unlock();
+        return count == client_count;
+    }), "every connection accepted once");
+
+    bool flags = true, peer_match = true, local_match = true, busy_poll = true;
+    for(auto &peer: accepted) {
+        flags &= peer.non_blocking && peer.close_on_exec;
+        busy_poll &= peer.busy_poll == busy_poll_in_us;
+        local_match &= peer.local_addr.port == rohit::ipv6_port_t(port);
+
+        bool found = false;
+        for(auto &client: clients) {
+            if (same_addr(client->get_local_ipv6_addr(), peer.peer_addr)) found = true;
+        }
+        peer_match &= found;
+    }
+    check(flags, "accepted socket is non blocking and close on exec");
+    check(peer_match, "peer address captured at accept");
+    check(local_match, "local address port");
+    check(busy_poll, "peer carries busy poll budget of its listener");
+
+    clients.clear();
+    evtdist.terminate();
+    evtdist.wait();
+    server.close();
+}
+
+// Pending connections are shed when accept runs out of descriptors, and
+// listener keeps accepting once descriptors are free again
+void test_accept_shed() {
+    accepted.clear();
+    rohit::event_distributor evtdist(1, rohit::event_mode_t::SHARED);
+    evtdist.init();
+    rohit::serverevent<record_peer, false> server(port + 2, 100);
+    server.init(evtdist);
+
+    rlimit saved_limit;
+    getrlimit(RLIMIT_NOFILE, &saved_limit);
+    rlimit limit { std::min<rlim_t>(saved_limit.rlim_cur, 256), saved_limit.rlim_max };
+    setrlimit(RLIMIT_NOFILE, &limit);
+
+    std::vector<int> fillers;
+    while(true) {
+        const int fd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+        if (fd < 0) break;
+        fillers.push_back(fd);
+    }
+
+    // Leave just enough descriptors for clients, none for accept
+    std::vector<std::unique_ptr<rohit::client_socket_t>> clients;
+    for(size_t index = 0; index < client_count && !fillers.empty(); ++index) {
+        ::close(fillers.back());
+        fillers.pop_back();
+        clients.emplace_back(new rohit::client_socket_t(rohit::ipv6_socket_addr_t("::1", port + 2)));
+    }
+    check(wait_for([&] { return server.get_shed_count() == client_count; }), "every pending connection shed");
+
+    for(auto fd: fillers) ::close(fd);
+    setrlimit(RLIMIT_NOFILE, &saved_limit);
+
+    rohit::client_socket_t client(rohit::ipv6_socket_addr_t("::1", port + 2));
+    check(wait_for([&] {
+        accepted_lock.lock();
+        const auto count = accepted.size();
+        accepted_lock.unlock();
+        return count == 1;
+    }), "listener accepts after descriptors are free");
+
+    clients.clear();
+    evtdist.terminate();
+    evtdist.wait();
+    server.close();
+}
+
+int main() {
+    rohit::init_iot("/tmp/iotcloud_testaccept.log");
+
+    test_accept(rohit::event_mode_t::SHARED);
+
+    // Listener without reuseport is shared by both shards
+    test_accept(rohit::event_mode_t::SHARDED);
+
+    // Only peers of this listener make loop thread spin
+    test_accept(rohit::event_mode_t::SHARED, 20);
+
+    test_accept_shed();
+
+    rohit::serverevent<record_peer, false> server(port + 1, 100);
+    server.set_busy_poll(rohit::config::event_dist_max_busy_poll_in_us + 1);
+    check(server.get_busy_poll() == rohit::config::event_dist_max_busy_poll_in_us, "busy poll budget is capped");
+    server.close();
+
+    rohit::destroy_iot();
+
+    return test_summary();
+}
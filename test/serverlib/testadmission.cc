@@ -0,0 +1,165 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <iot/net/serverevent.hh>
+#include <iot/watcher/helperevent.hh>
+#include <iot/init.hh>
+#include <testcheck.hh>
+#include <iostream>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+template <typename PRED>
+bool wait_for(PRED pred) {
+    for(int count = 0; count < 500; ++count) {
+        if (pred()) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return pred();
+}
+
+// Accepted peer closes when client hangs up, rejected one gets "busy"
+class admission_peer : public rohit::serverpeerevent<false> {
+public:
+    static constexpr bool movable = false;
+    using rohit::serverpeerevent<false>::serverpeerevent;
+
+    static void reject(const int fd) {
+        ::send(fd, "busy", 4, MSG_DONTWAIT | MSG_NOSIGNAL);
+    }
+
+protected:
+    void execute() override {
+        if (client_state == rohit::state_t::SOCKET_PEER_CLOSE) {
+            close();
+            return;
+        }
+        // Peer never writes, so an empty read means it has hung up
+        char buffer[16];
+        size_t read_len = 0;
+        const auto ret = peer_id.read(buffer, sizeof(buffer), read_len);
+        if (ret == rohit::err_t::SUCCESS && read_len == 0) close();
+    }
+};
+
+// Returns true if server replied busy and closed connection
+bool is_rejected(rohit::client_socket_t &client) {
+    char buffer[16];
+    size_t read_len = 0;
+    if (client.read(buffer, sizeof(buffer), read_len) != rohit::err_t::SUCCESS) return false;
+    return read_len == 4 && memcmp(buffer, "busy", 4) == 0;
+}
+
+typedef rohit::serverevent<admission_peer, false> server_type;
+
+std::unique_ptr<rohit::client_socket_t> connect(const int port) {
+    return std::unique_ptr<rohit::client_socket_t>(new rohit::client_socket_t(rohit::ipv6_socket_addr_t("::1", port)));
+}
+
+void test_connection_cap() {
+    constexpr int port = 18701;
+    rohit::event_distributor evtdist(2);
+    evtdist.init();
+    server_type server(port, 3);
+    server.set_backlog(64);
+    server.init(evtdist);
+
+    std::vector<std::unique_ptr<rohit::client_socket_t>> clients;
+    for(int index = 0; index < 3; ++index) clients.push_back(connect(port));
+    check(wait_for([&] { return server.get_connection_count() == 3; }), "connections up to cap accepted");
+
+    auto over_cap = connect(port);
+    check(is_rejected(*over_cap), "connection over cap rejected with busy reply");
+    over_cap->close();
+    check(server.get_rejected_count() == 1 && server.get_connection_count() == 3, "rejected connection not counted");
+
+    // Closed connection frees its slot
+    clients.back()->close();
+    clients.pop_back();
+    check(wait_for([&] { return server.get_connection_count() == 2; }), "closed connection counted down");
+    clients.push_back(connect(port));
+    check(wait_for([&] { return server.get_connection_count() == 3; }), "freed slot reused");
+    check(server.get_rejected_count() == 1, "no rejection below cap");
+
+    for(auto &client: clients) client->close();
+    evtdist.terminate();
+    evtdist.wait();
+    server.close();
+}
+
+void test_accept_rate() {
+    constexpr int port = 18702;
+    rohit::event_distributor evtdist(1);
+    evtdist.init();
+    server_type server(port, 100);
+
+    // Burst of 2, then one per second
+    server.set_accept_rate(1, 2);
+    server.init(evtdist);
+
+    std::vector<std::unique_ptr<rohit::client_socket_t>> clients;
+    for(int index = 0; index < 2; ++index) clients.push_back(connect(port));
+    check(wait_for([&] { return server.get_connection_count() == 2; }), "burst accepted");
+
+    auto paced = connect(port);
+    check(is_rejected(*paced), "connection above rate rejected");
+    paced->close();
+    check(server.get_connection_count() == 2, "paced connection not counted");
+
+    for(auto &client: clients) client->close();
+    evtdist.terminate();
+    evtdist.wait();
+    server.close();
+}
+
+// Request already received when connection is rejected must not turn
+// close into reset, busy reply is followed by end of stream
+void test_reject_with_request() {
+    constexpr int port = 18703;
+    rohit::event_distributor evtdist(1);
+    evtdist.init();
+    server_type server(port, 1);
+
+    // Both connections and request are queued before listener is served
+    auto accepted = connect(port);
+    auto over_cap = connect(port);
+    constexpr char request[] = "request sent before reply";
+    size_t written = 0;
+    check(over_cap->write(request, sizeof(request), written) == rohit::err_t::SUCCESS && written == sizeof(request), "request sent");
+    server.init(evtdist);
+
+    check(is_rejected(*over_cap), "connection with unread request rejected with busy reply");
+    char buffer[16];
+    size_t read_len = 1;
+    check(over_cap->read(buffer, sizeof(buffer), read_len) == rohit::err_t::SUCCESS && read_len == 0, "rejected connection closed without reset");
+
+    over_cap->close();
+    accepted->close();
+    evtdist.terminate();
+    evtdist.wait();
+    server.close();
+}
+
+int main() {
+    rohit::init_iot("/tmp/iotcloud_testadmission.log");
+
+    test_connection_cap();
+    test_accept_rate();
+    test_reject_with_request();
+
+    rohit::destroy_iot();
+
+    return test_summary();
+}
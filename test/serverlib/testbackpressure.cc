@@ -0,0 +1,155 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <iot/net/serverevent.hh>
+#include <iot/init.hh>
+#include <testcheck.hh>
+#include <iostream>
+#include <string.h>
+#include <sys/socket.h>
+#include <vector>
+
+// Peer is driven directly over socketpair without event loop
+class pressure_peer : public rohit::serverpeerevent<false> {
+public:
+    using rohit::serverpeerevent<false>::serverpeerevent;
+    using rohit::serverpeerevent<false>::write_all;
+    using rohit::serverpeerevent<false>::can_read;
+
+    void queue(const size_t size) {
+        auto buffer = rohit::io_buffer::alloc(size);
+        memset(buffer->data(), 'x', size);
+        push_write(buffer, size);
+    }
+
+protected:
+    void execute() override { }
+};
+
+size_t read_some(const int fd, const size_t max_size) {
+    std::vector<uint8_t> buffer(max_size);
+    auto ret = ::recv(fd, buffer.data(), buffer.size(), MSG_DONTWAIT);
+    return ret > 0 ? static_cast<size_t>(ret) : 0;
+}
+
+void test_accounting() {
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds);
+    const int buffer_size = 4096;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+    rohit::socket_t socket(fds[0]);
+    pressure_peer peer(socket);
+
+    peer.queue(1000);
+    peer.queue(3000);
+    peer.push_write_static((const uint8_t *)"static", 6);
+    check(peer.get_write_queued() == 4006, "queued bytes of all entries");
+
+    for (int index = 0; index < 100; ++index) peer.queue(1000);
+    peer.write_all();
+    check(peer.is_write_left(), "socket is full");
+
+    // Partly written front entry is not counted, bytes in socket buffer
+    // are neither queued nor read
+    size_t written = 0;
+    bool consistent = true;
+    while (peer.is_write_left()) {
+        written += read_some(fds[1], 2048);
+        peer.write_all();
+        consistent = consistent && peer.get_write_queued() + written <= 104006;
+    }
+    while (const size_t size = read_some(fds[1], 64 * 1024)) written += size;
+    check(consistent, "queued bytes follow partial writes");
+    check(!peer.is_write_left() && peer.get_write_queued() == 0, "nothing queued once written");
+    check(written == 104006, "every byte written");
+
+    peer.queue(500);
+    peer.clear();
+    check(peer.get_write_queued() == 0, "clear resets queued bytes");
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+void test_watermark() {
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds);
+    const int buffer_size = 4096;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+    rohit::socket_t socket(fds[0]);
+    pressure_peer peer(socket);
+
+    auto watermark = std::make_shared<rohit::write_watermark>();
+    watermark->high = 64 * 1024;
+    watermark->low = 16 * 1024;
+    peer.set_write_watermark(watermark);
+
+    check(peer.can_read(), "empty queue reads");
+
+    // Slow reader, responses pile up
+    for (int index = 0; index < 80; ++index) peer.queue(1024);
+    peer.write_all();
+    check(!peer.can_read(), "high watermark stops reading");
+    check(peer.is_read_paused(), "peer is paused");
+    check(watermark->paused_count == 1 && watermark->pause_total == 1, "pause is counted");
+    check(watermark->max_queued >= 64 * 1024, "queue depth is recorded");
+
+    // Between watermarks peer stays paused
+    while (peer.get_write_queued() > 32 * 1024) {
+        read_some(fds[1], 2048);
+        peer.write_all();
+    }
+    check(!peer.can_read(), "stays paused above low watermark");
+
+    while (peer.get_write_queued() > 16 * 1024) {
+        read_some(fds[1], 2048);
+        peer.write_all();
+    }
+    check(peer.can_read(), "low watermark resumes reading");
+    check(watermark->paused_count == 0 && watermark->pause_total == 1, "resume is counted");
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+// Peer without listener uses config watermarks
+void test_default() {
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds);
+    rohit::socket_t socket(fds[0]);
+    pressure_peer peer(socket);
+
+    auto buffer = rohit::io_buffer::alloc(rohit::config::socket_write_high_watermark);
+    peer.push_write(buffer, rohit::config::socket_write_high_watermark - 1);
+    check(peer.can_read(), "below config high watermark");
+    peer.push_write_static((const uint8_t *)"x", 1);
+    check(!peer.can_read(), "config high watermark");
+    peer.clear();
+    check(peer.can_read(), "empty queue resumes");
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+int main() {
+    rohit::init_iot("/tmp/iotcloud_testbackpressure.log");
+
+    test_accounting();
+    test_watermark();
+    test_default();
+
+    rohit::destroy_iot();
+
+    return test_summary();
+}
@@ -0,0 +1,228 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <iot/states/compute_pool.hh>
+#include <iot/watcher/helperevent.hh>
+#include <iot/security/crypto_job.hh>
+#include <openssl/rand.h>
+#include <iot/init.hh>
+#include <testcheck.hh>
+#include <iostream>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+template <typename PRED>
+bool wait_for(PRED pred) {
+    for(int count = 0; count < 500; ++count) {
+        if (pred()) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return pred();
+}
+
+std::atomic<int> executor_freed { 0 };
+
+// Owns one job, records where its completion was executed
+class job_executor : public rohit::event_executor {
+public:
+    std::unique_ptr<rohit::compute_job> job { };
+    std::atomic<bool> completed { false };
+    std::atomic<bool> completed_on_loop { false };
+    std::atomic<size_t> completed_thread { SIZE_MAX };
+
+    ~job_executor() { ++executor_freed; }
+
+    rohit::event_distributor *evtdist { nullptr };
+
+protected:
+    void execute() override {
+        if (!job || !job->is_done() || completed) return;
+        completed_on_loop = rohit::ctx.is_loop_thread(evtdist);
+        completed_thread = rohit::ctx.get_thread_index();
+        completed = true;
+    }
+
+    void flush() override { }
+    void close() override { rohit::ctx.delayed_free(this); }
+};
+
+template <typename FUNC>
+rohit::compute_job *make_job(const rohit::compute_kind_t kind, FUNC &&function) {
+    return new rohit::compute_job_function<std::decay_t<FUNC>>(kind, std::forward<FUNC>(function));
+}
+
+void test_key_derivation(rohit::event_distributor &evtdist) {
+    using namespace rohit::crypto;
+    openssl_ec_key_mem server_key, client_key;
+    generate_ec_key("prime256v1", server_key);
+    generate_ec_key("prime256v1", client_key);
+    openssl_mem server_public_key, client_public_key;
+    get_public_key_binary(server_key, server_public_key);
+    get_public_key_binary(client_key, client_public_key);
+
+    key_aes_256_gsm_t client_symmetric_key;
+    get_symmetric_key_from_ec(rohit::crypto::encryption_id_t::aes_256_gsm, client_key, server_public_key, client_symmetric_key);
+
+    job_executor executor { };
+    executor.evtdist = &evtdist;
+    auto job = new key_derivation_job(server_key, client_public_key);
+    executor.job.reset(job);
+    evtdist.submit_job(&executor, job);
+
+    check(wait_for([&] { return executor.completed.load(); }), "key derivation completed");
+    check(job->get_result() == rohit::err_t::SUCCESS, "key derived on compute thread");
+    check(memcmp(&job->get_key(), &client_symmetric_key, sizeof(client_symmetric_key)) == 0, "derived keys match");
+
+    // Executor has not been added to any shard, owner is first loop thread
+    check(executor.completed_on_loop && executor.completed_thread == 0, "completion on owning loop thread");
+
+    const auto stats = evtdist.get_compute_pool()->get_stats(rohit::compute_kind_t::KEY_DERIVATION);
+    check(stats.job_count == 1 && stats.run_ns > 0, "key derivation accounted");
+
+    // Completion task holds executor till it is done
+    check(wait_for([&] { return !executor.is_held(); }), "hold released");
+}
+
+void test_aes(rohit::event_distributor &evtdist) {
+    using namespace rohit::crypto;
+    key_aes_256_gsm_t key;
+    uint8_t random_value[16];
+    RAND_bytes(key.symetric_key, sizeof(key.symetric_key));
+    RAND_bytes(random_value, sizeof(random_value));
+
+    constexpr char message[] = "Large payload is encrypted off loop thread.";
+    const rohit::mem<void> data { (void *)message, sizeof(message) };
+
+    job_executor encrypt_executor { };
+    encrypt_executor.evtdist = &evtdist;
+    auto encrypt = new encrypt_job(key, rohit::guid_t(random_value), data);
+    encrypt_executor.job.reset(encrypt);
+    evtdist.submit_job(&encrypt_executor, encrypt);
+    check(wait_for([&] { return encrypt_executor.completed.load(); }), "encryption completed");
+    check(encrypt->get_result() == rohit::err_t::SUCCESS, "encrypted on compute thread");
+    check(encrypt_executor.completed_on_loop, "encryption completion on loop thread");
+
+    job_executor decrypt_executor { };
+    decrypt_executor.evtdist = &evtdist;
+    auto decrypt = new decrypt_job(key, encrypt->get_encrypted_data());
+    decrypt_executor.job.reset(decrypt);
+    evtdist.submit_job(&decrypt_executor, decrypt);
+    check(wait_for([&] { return decrypt_executor.completed.load(); }), "decryption completed");
+    check(decrypt->get_result() == rohit::err_t::SUCCESS, "decrypted on compute thread");
+    auto &decrypted = decrypt->get_decrypted_data();
+    check(decrypted.size == sizeof(message) && memcmp(decrypted.ptr, message, sizeof(message)) == 0, "decrypted data matches");
+
+    const auto stats = evtdist.get_compute_pool()->get_stats(rohit::compute_kind_t::ENCRYPTION);
+    check(stats.job_count == 2, "encryption accounted");
+
+    check(wait_for([&] { return !encrypt_executor.is_held() && !decrypt_executor.is_held(); }), "hold released");
+}
+
+void test_steal(rohit::event_distributor &evtdist) {
+    constexpr size_t job_count = 200;
+    std::atomic<bool> release_blocker { false };
+    std::vector<std::unique_ptr<job_executor>> executors;
+    std::atomic<size_t> ran { 0 };
+    std::vector<std::atomic<bool>> ran_on_blocked(job_count);
+
+    // First job blocks one compute thread, rest must be stolen by other one
+    auto blocker = std::make_unique<job_executor>();
+    blocker->evtdist = &evtdist;
+    std::atomic<pthread_t> blocked_thread { };
+    blocker->job.reset(make_job(rohit::compute_kind_t::OTHER, [&] {
+        blocked_thread = pthread_self();
+        while (!release_blocker) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }));
+    evtdist.submit_job(blocker.get(), blocker->job.get());
+    check(wait_for([&] { return !pthread_equal(blocked_thread.load(), pthread_t { }); }), "blocking job started");
+
+    for(size_t index = 0; index < job_count; ++index) {
+        auto executor = std::make_unique<job_executor>();
+        executor->evtdist = &evtdist;
+        executor->job.reset(make_job(rohit::compute_kind_t::COMPRESSION, [&, index] {
+            ran_on_blocked[index] = pthread_equal(pthread_self(), blocked_thread.load()) != 0;
+            ++ran;
+        }));
+        evtdist.submit_job(executor.get(), executor->job.get());
+        executors.push_back(std::move(executor));
+    }
+
+    check(wait_for([&] { return ran == job_count; }), "jobs ran while one compute thread blocked");
+    bool any_on_blocked = false;
+    for(auto &value: ran_on_blocked) any_on_blocked |= value.load();
+    check(!any_on_blocked, "blocked thread did not run other jobs");
+    check(wait_for([&] {
+        for(auto &executor: executors) if (!executor->completed) return false;
+        return true;
+    }), "all completions executed");
+
+    release_blocker = true;
+    check(wait_for([&] { return blocker->completed.load(); }), "blocking job completed");
+    check(wait_for([&] {
+        if (blocker->is_held()) return false;
+        for(auto &executor: executors) if (executor->is_held()) return false;
+        return true;
+    }), "holds released");
+}
+
+void test_hold_defers_free(rohit::event_distributor &evtdist) {
+    executor_freed = 0;
+    auto executor = new job_executor();
+    executor->evtdist = &evtdist;
+    executor->job.reset(make_job(rohit::compute_kind_t::ENCRYPTION, [] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }));
+    evtdist.submit_job(executor, executor->job.get());
+    evtdist.delayed_free(executor);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    check(executor_freed == 0, "held executor not freed while job runs");
+    check(wait_for([&] { return executor_freed == 1; }), "executor freed after completion");
+}
+
+void test_inline_without_pool() {
+    rohit::event_distributor evtdist(1);
+    evtdist.init();
+
+    bool ran = false;
+    job_executor executor { };
+    executor.job.reset(make_job(rohit::compute_kind_t::OTHER, [&] { ran = true; }));
+    evtdist.submit_job(&executor, executor.job.get());
+    check(ran && executor.job->is_done(), "job runs inline without compute pool");
+
+    evtdist.terminate();
+    evtdist.wait();
+}
+
+int main() {
+    rohit::init_iot("/tmp/iotcloud_testcomputepool.log");
+    {
+        rohit::event_distributor evtdist(2, rohit::event_mode_t::SHARDED);
+        evtdist.init();
+        evtdist.init_compute(2);
+
+        test_key_derivation(evtdist);
+        test_aes(evtdist);
+        test_steal(evtdist);
+        test_hold_defers_free(evtdist);
+
+        evtdist.terminate();
+        evtdist.wait();
+    }
+    test_inline_without_pool();
+    rohit::destroy_iot();
+
+    return test_summary();
+}
@@ -0,0 +1,102 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <iot/net/coroutineevent.hh>
+#include <iot/watcher/helperevent.hh>
+#include <iot/init.hh>
+#include <testcheck.hh>
+#include <iostream>
+#include <string.h>
+#include <vector>
+
+std::atomic<int> executor_freed { 0 };
+
+// Echoes every message, "sleep" is answered after 50ms, "big" with 1MB
+class echo_coroutine : public rohit::coroutine_event<false> {
+public:
+    using rohit::coroutine_event<false>::coroutine_event;
+    ~echo_coroutine() { ++executor_freed; }
+
+protected:
+    rohit::event_coroutine handler() override {
+        co_await accept();
+        uint8_t buffer[64];
+        while (true) {
+            const size_t read_len = co_await read(buffer, sizeof(buffer));
+            if (read_len == 0) break;
+
+            if (read_len == 5 && memcmp(buffer, "sleep", 5) == 0) {
+                co_await sleep(50);
+                co_await write(reinterpret_cast<const uint8_t *>("slept"), 5);
+            } else if (read_len == 3 && memcmp(buffer, "big", 3) == 0) {
+                // Larger than socket buffer, write suspends till peer reads
+                std::vector<uint8_t> big(1024 * 1024, 0x5a);
+                co_await write(big.data(), big.size());
+            } else {
+                co_await write(buffer, read_len);
+            }
+        }
+    }
+};
+
+std::string round_trip(rohit::client_socket_t &client, const char *message, const size_t response_size) {
+    size_t written = 0;
+    client.write(message, strlen(message), written);
+    std::string response;
+    std::vector<char> buffer(64 * 1024);
+    while (response.size() < response_size) {
+        size_t read_len = 0;
+        if (client.read(buffer.data(), buffer.size(), read_len) != rohit::err_t::SUCCESS || read_len == 0) break;
+        response.append(buffer.data(), read_len);
+    }
+    return response;
+}
+
+int main() {
+    rohit::init_iot("/tmp/iotcloud_testcoroutine.log");
+    {
+        rohit::event_distributor evtdist(2, rohit::event_mode_t::SHARDED);
+        evtdist.init();
+        rohit::serverevent<echo_coroutine, false> server(18401, 100, true);
+        server.init(evtdist);
+
+        {
+            rohit::client_socket_t client(rohit::ipv6_socket_addr_t("::1", 18401));
+            check(round_trip(client, "hello", 5) == "hello", "echo");
+            check(round_trip(client, "world", 5) == "world", "second echo");
+
+            const auto start = std::chrono::steady_clock::now();
+            check(round_trip(client, "sleep", 5) == "slept", "reply after sleep");
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+            check(elapsed >= std::chrono::milliseconds(40), "sleep suspended handler");
+
+            const auto big = round_trip(client, "big", 1024 * 1024);
+            check(big.size() == 1024 * 1024 && big.find_first_not_of('\x5a') == std::string::npos, "large write completes");
+            check(round_trip(client, "again", 5) == "again", "echo after large write");
+            client.close();
+        }
+
+        for(int count = 0; count < 300 && executor_freed == 0; ++count) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        check(executor_freed == 1, "executor and frame freed on peer close");
+
+        evtdist.terminate();
+        evtdist.wait();
+        server.close();
+    }
+    rohit::destroy_iot();
+
+    return test_summary();
+}
@@ -0,0 +1,155 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <iot/net/serverevent.hh>
+#include <iot/watcher/helperevent.hh>
+#include <iot/init.hh>
+#include <testcheck.hh>
+#include <iostream>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+template <typename PRED>
+bool wait_for(PRED pred) {
+    for(int count = 0; count < 500; ++count) {
+        if (pred()) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return pred();
+}
+
+constexpr size_t big_size = 4 * 1024 * 1024;
+
+// "big" queues 4MB response, everything else is ignored
+class drain_peer : public rohit::serverpeerevent<false> {
+public:
+    static constexpr bool movable = false;
+    using rohit::serverpeerevent<false>::serverpeerevent;
+
+protected:
+    void execute() override {
+        if (client_state == rohit::state_t::SOCKET_PEER_CLOSE) {
+            close();
+            return;
+        }
+        if (client_state == rohit::state_t::SOCKET_PEER_WRITE) write_all();
+
+        uint8_t buffer[64];
+        size_t read_len = 0;
+        auto err = peer_id.read(buffer, sizeof(buffer), read_len);
+        if (err == rohit::err_t::SUCCESS && read_len == 3 && memcmp(buffer, "big", 3) == 0) {
+            auto big = rohit::io_buffer::alloc(big_size);
+            memset(big->data(), 0x5a, big_size);
+            push_write(big, big_size);
+            write_all();
+        }
+    }
+};
+
+// Ignores drain, closed only by drain deadline
+class stubborn_peer : public drain_peer {
+public:
+    using drain_peer::drain_peer;
+
+protected:
+    void drain() override { }
+};
+
+size_t read_until_close(rohit::client_socket_t &client) {
+    std::vector<char> buffer(64 * 1024);
+    size_t total = 0;
+    while(true) {
+        size_t read_len = 0;
+        if (client.read(buffer.data(), buffer.size(), read_len) != rohit::err_t::SUCCESS || read_len == 0) break;
+        total += read_len;
+    }
+    return total;
+}
+
+void test_graceful_drain() {
+    rohit::event_distributor evtdist(2, rohit::event_mode_t::SHARDED);
+    evtdist.init();
+    rohit::serverevent<drain_peer, false> server(18501, 100, true);
+    server.init(evtdist);
+
+    // Server and one shard listener
+    check(evtdist.get_tracked_count() == 2, "listeners tracked");
+
+    rohit::client_socket_t idle_client(rohit::ipv6_socket_addr_t("::1", 18501));
+    rohit::client_socket_t busy_client(rohit::ipv6_socket_addr_t("::1", 18501));
+    check(wait_for([&] { return evtdist.get_tracked_count() == 4; }), "peers tracked");
+
+    size_t written = 0;
+    busy_client.write("big", 3, written);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    bool drained = false;
+    std::thread drain_thread([&] { drained = evtdist.drain(3000); });
+
+    // Pending write is flushed before close
+    check(read_until_close(busy_client) == big_size, "pending write flushed");
+    check(read_until_close(idle_client) == 0, "idle peer closed");
+    drain_thread.join();
+    check(drained, "drained before deadline");
+    check(evtdist.get_tracked_count() == 0, "nothing tracked after drain");
+
+    bool refused = false;
+    try {
+        rohit::client_socket_t late_client(rohit::ipv6_socket_addr_t("::1", 18501));
+    } catch (const rohit::exception_t &) {
+        refused = true;
+    }
+    check(refused, "listener stopped accepting");
+
+    const auto start = std::chrono::steady_clock::now();
+    evtdist.terminate();
+    evtdist.wait();
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    check(elapsed < std::chrono::milliseconds(500), "terminate does not wait for timeouts");
+    server.close();
+}
+
+void test_drain_deadline() {
+    rohit::event_distributor evtdist(2, rohit::event_mode_t::SHARED);
+    evtdist.init();
+    rohit::serverevent<stubborn_peer, false> server(18502, 100);
+    server.init(evtdist);
+
+    rohit::client_socket_t client(rohit::ipv6_socket_addr_t("::1", 18502));
+    check(wait_for([&] { return evtdist.get_tracked_count() == 2; }), "stubborn peer tracked");
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto drained = evtdist.drain(200);
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    check(!drained, "drain reports deadline");
+    check(elapsed >= std::chrono::milliseconds(200) && elapsed < std::chrono::milliseconds(1000), "drain bounded by deadline");
+    check(evtdist.get_tracked_count() == 0, "stubborn peer force closed");
+    check(read_until_close(client) == 0, "force closed peer sees close");
+
+    evtdist.terminate();
+    evtdist.wait();
+    server.close();
+}
+
+int main() {
+    rohit::init_iot("/tmp/iotcloud_testdrain.log");
+
+    test_graceful_drain();
+    test_drain_deadline();
+
+    rohit::destroy_iot();
+
+    return test_summary();
+}
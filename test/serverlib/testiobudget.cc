@@ -0,0 +1,149 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <iot/states/event_distributor.hh>
+#include <iot/watcher/helperevent.hh>
+#include <iot/init.hh>
+#include <testcheck.hh>
+#include <iostream>
+#include <thread>
+
+template <typename PRED>
+bool wait_for(PRED pred) {
+    for(int count = 0; count < 500; ++count) {
+        if (pred()) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return pred();
+}
+
+constexpr size_t message_size = 1024;
+
+// Has pending messages of message_size, reads them like read_helper does
+class chatty_executor : public rohit::event_executor {
+public:
+    const int fd { eventfd(0, EFD_NONBLOCK) };
+    std::atomic<size_t> pending { 0 };
+    std::atomic<size_t> processed { 0 };
+    std::atomic<size_t> executed { 0 };
+
+    ~chatty_executor() { ::close(fd); }
+
+protected:
+    void execute() override {
+        uint64_t value;
+        while (::read(fd, &value, sizeof(value)) > 0) { }
+        ++executed;
+        while (pending > 0) {
+            --pending;
+            ++processed;
+            if (!rohit::ctx.consume_io_budget(message_size)) {
+                rohit::ctx.defer(this);
+                return;
+            }
+        }
+    }
+
+    void flush() override { }
+    void close() override { }
+};
+
+// Records how far chatty executor was when this was executed
+class quiet_executor : public rohit::event_executor {
+public:
+    const int fd { eventfd(0, EFD_NONBLOCK) };
+    chatty_executor *chatty { nullptr };
+    std::atomic<size_t> chatty_processed { SIZE_MAX };
+
+    ~quiet_executor() { ::close(fd); }
+
+protected:
+    void execute() override {
+        uint64_t value;
+        while (::read(fd, &value, sizeof(value)) > 0) { }
+        chatty_processed = chatty->processed.load();
+    }
+
+    void flush() override { }
+    void close() override { }
+};
+
+void signal(const int fd) {
+    const uint64_t value = 1;
+    (void)::write(fd, &value, sizeof(value));
+}
+
+// Both executors become ready in one batch while loop thread is busy
+void make_ready(rohit::event_distributor &evtdist, chatty_executor &chatty, quiet_executor &quiet) {
+    static std::atomic<bool> blocked;
+    static std::atomic<bool> release;
+    blocked = false;
+    release = false;
+    evtdist.post(0, [] {
+        blocked = true;
+        while (!release) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    });
+    wait_for([] { return blocked.load(); });
+    signal(chatty.fd);
+    signal(quiet.fd);
+    release = true;
+}
+
+void test_budget(rohit::event_distributor &evtdist) {
+    chatty_executor chatty { };
+    quiet_executor quiet { };
+    quiet.chatty = &chatty;
+    evtdist.add(chatty.fd, EPOLLIN, &chatty);
+    evtdist.add(quiet.fd, EPOLLIN, &quiet);
+
+    evtdist.set_io_budget(4 * message_size);
+    chatty.pending = 100;
+    make_ready(evtdist, chatty, quiet);
+
+    check(wait_for([&] { return chatty.processed == 100; }), "deferred executor finishes without new event");
+    check(wait_for([&] { return quiet.chatty_processed != SIZE_MAX; }), "quiet executor executed");
+    check(quiet.chatty_processed <= 4, "quiet executor not starved by chatty one");
+    // Last budget ends exactly at last message, one more execute finds nothing
+    check(chatty.executed == 26, "chatty executor executed once per budget");
+    check(wait_for([&] { return !chatty.is_held(); }), "deferred executor released");
+
+    // No budget, everything is read in one dispatch
+    evtdist.set_io_budget(0);
+    chatty.executed = 0;
+    chatty.processed = 0;
+    chatty.pending = 100;
+    quiet.chatty_processed = SIZE_MAX;
+    make_ready(evtdist, chatty, quiet);
+    check(wait_for([&] { return chatty.processed == 100 && quiet.chatty_processed != SIZE_MAX; }), "unlimited budget processed");
+    check(chatty.executed == 1, "unlimited budget executes once");
+
+    evtdist.remove(chatty.fd, &chatty);
+    evtdist.remove(quiet.fd, &quiet);
+}
+
+int main() {
+    rohit::init_iot("/tmp/iotcloud_testiobudget.log");
+    {
+        rohit::event_distributor evtdist(1);
+        evtdist.init();
+
+        test_budget(evtdist);
+
+        evtdist.terminate();
+        evtdist.wait();
+    }
+    rohit::destroy_iot();
+
+    return test_summary();
+}
@@ -0,0 +1,206 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <iot/core/io_buffer.hh>
+#include <iot/net/serverevent.hh>
+#include <iot/init.hh>
+#include <testcheck.hh>
+#include <filesystem>
+#include <iostream>
+#include <string.h>
+#include <sys/socket.h>
+#include <thread>
+#include <vector>
+
+void test_pool() {
+    auto &pool = rohit::io_buffer_pool::local();
+    auto first = rohit::io_buffer::alloc(100);
+    check(first->capacity() == 256, "smallest size class");
+    first->release();
+
+    const auto reuse_count = pool.get_reuse_count();
+    auto second = rohit::io_buffer::alloc(200);
+    check(second == first, "released buffer reused");
+    check(pool.get_reuse_count() == reuse_count + 1, "reuse counted");
+
+    check(second->share() == second && second->use_count() == 2, "share adds reference");
+    second->release();
+    check(second->use_count() == 1, "release drops reference");
+    second->release();
+
+    auto large = rohit::io_buffer::alloc(1024 * 1024);
+    check(large->capacity() == 1024 * 1024, "large buffer exact size");
+    memset(large->data(), 0x11, large->capacity());
+    large->release();
+}
+
+void test_remote_release() {
+    auto buffer = rohit::io_buffer::alloc(4000);
+    std::thread other([buffer] { buffer->release(); });
+    other.join();
+
+    // Owner picks it from remote list when its free list is empty
+    auto next = rohit::io_buffer::alloc(4000);
+    check(next == buffer, "buffer released on other thread returns to owner");
+    next->release();
+
+    // Pool of exited thread stays till its last buffer is released
+    rohit::io_buffer *orphan = nullptr;
+    std::thread exiting([&orphan] {
+        orphan = rohit::io_buffer::alloc(1000);
+        auto unused = rohit::io_buffer::alloc(1000);
+        unused->release();
+    });
+    exiting.join();
+    memset(orphan->data(), 0x22, orphan->capacity());
+    orphan->release();
+    check(true, "buffer of exited thread released");
+}
+
+class write_peer : public rohit::serverpeerevent<false> {
+public:
+    using rohit::serverpeerevent<false>::serverpeerevent;
+    using rohit::serverpeerevent<false>::write_all;
+
+protected:
+    void execute() override { }
+};
+
+void read_available(const int fd, std::vector<uint8_t> &received) {
+    uint8_t buffer[64 * 1024];
+    while(true) {
+        auto ret = ::recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (ret <= 0) break;
+        received.insert(received.end(), buffer, buffer + ret);
+    }
+}
+
+// Same response buffer in write queue of two connections
+void test_shared() {
+    auto response = rohit::io_buffer::alloc(1000);
+    for(size_t index = 0; index < 1000; ++index) response->data()[index] = static_cast<uint8_t>(index);
+
+    int first_fds[2];
+    int second_fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, first_fds);
+    socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, second_fds);
+    rohit::socket_t first_socket(first_fds[0]);
+    rohit::socket_t second_socket(second_fds[0]);
+    {
+        write_peer first(first_socket);
+        write_peer second(second_socket);
+
+        first.push_write(response->share(), response->data(), 1000);
+        second.push_write(response->share(), response->data() + 500, 500);
+        check(response->use_count() == 3, "each queue holds reference");
+
+        first.write_all();
+        check(response->use_count() == 2, "written entry drops reference");
+
+        // Unsent entry is released with connection
+    }
+    check(response->use_count() == 1, "queue destroyed drops reference");
+
+    std::vector<uint8_t> received;
+    read_available(first_fds[1], received);
+    check(received.size() == 1000 && memcmp(received.data(), response->data(), 1000) == 0, "shared buffer sent");
+    response->release();
+
+    ::close(first_fds[0]);
+    ::close(first_fds[1]);
+    ::close(second_fds[0]);
+    ::close(second_fds[1]);
+}
+
+class tls_write_peer : public rohit::serverpeerevent<true> {
+public:
+    using rohit::serverpeerevent<true>::serverpeerevent;
+    using rohit::serverpeerevent<true>::write_all;
+
+protected:
+    void execute() override { }
+};
+
+// Small entries go out as one TLS record
+void test_tls_coalesce(const char *cert_file) {
+    if (!std::filesystem::exists(cert_file)) {
+        std::cout << "Skipping TLS coalesce, certificate not found: " << cert_file << std::endl;
+        return;
+    }
+
+    constexpr int port = 18801;
+    constexpr size_t entry_count = 50;
+    constexpr size_t entry_size = 100;
+    rohit::server_socket_ssl_t server(port, cert_file, cert_file);
+
+    std::vector<uint8_t> received;
+    std::thread client_thread([&received] {
+        SSL_CTX *client_ctx = SSL_CTX_new(TLS_client_method());
+        rohit::client_socket_t client(rohit::ipv6_socket_addr_t("::1", port));
+        SSL *ssl = SSL_new(client_ctx);
+        SSL_set_fd(ssl, client);
+        if (SSL_connect(ssl) > 0) {
+            uint8_t buffer[16 * 1024];
+            while (received.size() < entry_count * entry_size) {
+                auto ret = SSL_read(ssl, buffer, sizeof(buffer));
+                if (ret <= 0) break;
+                received.insert(received.end(), buffer, buffer + ret);
+            }
+        }
+        SSL_free(ssl);
+        client.close();
+        SSL_CTX_free(client_ctx);
+    });
+
+    // Listener is blocking, accept waits for client
+    rohit::ipv6_socket_addr_t peer_addr;
+    rohit::socket_ssl_t accepted = server.accept(server, peer_addr);
+    auto err = rohit::err_t::SOCKET_RETRY;
+    for(int attempt = 0; attempt < 500 && err == rohit::err_t::SOCKET_RETRY; ++attempt) {
+        err = accepted.accept();
+        if (err == rohit::err_t::SOCKET_RETRY) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    check(err == rohit::err_t::SUCCESS, "TLS handshake");
+
+    tls_write_peer peer(accepted);
+    std::vector<uint8_t> expected;
+    for(size_t entry = 0; entry < entry_count; ++entry) {
+        auto io = rohit::io_buffer::alloc(entry_size);
+        memset(io->data(), static_cast<int>(entry), entry_size);
+        expected.insert(expected.end(), io->data(), io->data() + entry_size);
+        peer.push_write(io, entry_size);
+    }
+    peer.write_all();
+    check(!peer.is_write_left(), "TLS entries written");
+    check(peer.get_flush_count() == 1, "small TLS entries coalesced into one write");
+
+    client_thread.join();
+    check(received == expected, "coalesced TLS bytes in queue order");
+    accepted.close();
+    server.close();
+}
+
+int main(int argc, char *argv[]) {
+    const char *cert_file = argc > 1 ? argv[1] : "../../resources/key/testcert.pem";
+    rohit::init_iot("/tmp/iotcloud_testiobuffer.log");
+
+    test_pool();
+    test_remote_release();
+    test_shared();
+    test_tls_coalesce(cert_file);
+
+    rohit::destroy_iot();
+
+    return test_summary();
+}
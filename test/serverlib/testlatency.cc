@@ -0,0 +1,131 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <iot/states/event_distributor.hh>
+#include <iot/watcher/helperevent.hh>
+#include <iot/init.hh>
+#include <testcheck.hh>
+#include <iostream>
+#include <thread>
+
+template <typename PRED>
+bool wait_for(PRED pred) {
+    for(int count = 0; count < 500; ++count) {
+        if (pred()) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return pred();
+}
+
+// Every wakeup takes 2ms
+class slow_executor : public rohit::event_executor {
+public:
+    const int fd { eventfd(0, EFD_NONBLOCK) };
+    std::atomic<size_t> executed { 0 };
+
+    ~slow_executor() { ::close(fd); }
+
+protected:
+    void execute() override {
+        uint64_t value;
+        while (::read(fd, &value, sizeof(value)) > 0) { }
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        ++executed;
+    }
+
+    void flush() override { }
+    void close() override { }
+};
+
+void test_buckets() {
+    using namespace rohit;
+    bool exact = true;
+    for(uint64_t value = 0; value < latency_bucket::sub_bucket_count; ++value) {
+        if (latency_bucket::lower(latency_bucket::index(value)) != value) exact = false;
+    }
+    check(exact, "small values have exact bucket");
+
+    bool bounded = true;
+    for(uint64_t value = 8; value < 100000000; value = value * 3 / 2 + 1) {
+        const auto lower = latency_bucket::lower(latency_bucket::index(value));
+        if (lower > value || value - lower > value / latency_bucket::sub_bucket_count) bounded = false;
+    }
+    check(bounded, "bucket error within one sub bucket");
+    check(latency_bucket::index(UINT64_MAX) == latency_bucket::count - 1, "large value clamped to last bucket");
+
+    latency_histogram histogram { };
+    for(uint64_t value = 1; value <= 1000; ++value) histogram.record(value * 1000);
+    latency_snapshot snapshot { };
+    snapshot.add(histogram);
+    check(snapshot.count == 1000 && snapshot.max_ns == 1000000, "snapshot count and max");
+    const auto p50 = snapshot.percentile(50);
+    const auto p99 = snapshot.percentile(99);
+    check(p50 > 440000 && p50 <= 501000, "p50 within bucket error");
+    check(p99 > 870000 && p99 <= 991000, "p99 within bucket error");
+    check(snapshot.mean() == 500500, "mean");
+}
+
+void test_clock() {
+    using namespace rohit;
+    const auto start = cycle_clock::now();
+    const auto coarse_start = coarse_now_ns();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    const auto elapsed = cycle_clock::to_ns(cycle_clock::now() - start);
+    const auto coarse_elapsed = coarse_now_ns() - coarse_start;
+    check(elapsed >= 50000000 && elapsed < 200000000, "cycle clock converts to nanoseconds");
+    check(coarse_elapsed >= 40000000 && coarse_elapsed < 200000000, "coarse clock advances");
+}
+
+void test_dispatch_latency(rohit::event_distributor &evtdist) {
+    slow_executor executor { };
+    evtdist.add(executor.fd, EPOLLIN, &executor);
+
+    for(size_t count = 0; count < 10; ++count) {
+        const uint64_t value = 1;
+        (void)::write(executor.fd, &value, sizeof(value));
+        const size_t expected = count + 1;
+        wait_for([&] { return executor.executed >= expected; });
+    }
+
+    const rohit::latency_report *found = nullptr;
+    const auto reports = evtdist.get_latency_reports();
+    for(auto &report: reports) {
+        if (report.type == &typeid(slow_executor)) found = &report;
+    }
+    check(found != nullptr, "executor type reported");
+    if (found != nullptr) {
+        check(found->snapshot.count == 10, "every dispatch recorded");
+        check(found->snapshot.percentile(50) >= 1500000, "dispatch latency includes execute");
+    }
+
+    evtdist.remove(executor.fd, &executor);
+}
+
+int main() {
+    rohit::init_iot("/tmp/iotcloud_testlatency.log");
+    {
+        rohit::event_distributor evtdist(1);
+        evtdist.init();
+
+        test_buckets();
+        test_clock();
+        test_dispatch_latency(evtdist);
+
+        evtdist.terminate();
+        evtdist.wait();
+    }
+    rohit::destroy_iot();
+
+    return test_summary();
+}
@@ -0,0 +1,202 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <iot/net/serverevent.hh>
+#include <iot/message.hh>
+#include <iot/init.hh>
+#include <testcheck.hh>
+#include <iostream>
+#include <string.h>
+#include <sys/socket.h>
+#include <vector>
+
+// Peer is driven directly over socketpair, each call reads once and
+// collects codes of complete device messages
+class receive_peer : public rohit::serverpeerevent<false> {
+public:
+    using rohit::serverpeerevent<false>::serverpeerevent;
+    using rohit::serverpeerevent<false>::receive;
+
+    std::vector<rohit::message::Code> codes;
+
+    rohit::err_t read_messages() {
+        size_t read_length { };
+        auto err = receive(read_length);
+        if (err != rohit::err_t::SUCCESS) return err;
+
+        while (true) {
+            const size_t message_length = rohit::message::frame_length(receive_buffer.data(), receive_buffer.size());
+            if (message_length == 0 || message_length > receive_buffer.size()) break;
+            codes.push_back(reinterpret_cast<const rohit::message::Base *>(receive_buffer.data())->getMessageCode());
+            receive_buffer.consume(message_length);
+        }
+        return err;
+    }
+
+    size_t pending() const { return receive_buffer.size(); }
+    size_t capacity() const { return receive_buffer.capacity(); }
+
+protected:
+    void execute() override { }
+};
+
+void test_stream_buffer() {
+    auto &pool = rohit::io_buffer_pool::local();
+    rohit::stream_buffer stream;
+    check(stream.capacity() == 0, "buffer is not taken before first read");
+
+    check(stream.reserve(rohit::config::socket_peer_read_min_free, rohit::config::socket_peer_read_max), "first reserve");
+    check(stream.capacity() >= rohit::config::socket_peer_read_size, "first buffer has read size");
+    memset(stream.tail(), 'a', 100);
+    stream.commit(100);
+    stream.consume(60);
+    check(stream.size() == 40 && stream.data()[0] == 'a', "partial consume keeps rest");
+    stream.consume(40);
+    check(stream.capacity() == 0, "buffer goes back to pool once consumed");
+
+    const auto alloc_count = pool.get_alloc_count();
+    const auto reuse_count = pool.get_reuse_count();
+    stream.reserve(rohit::config::socket_peer_read_min_free, rohit::config::socket_peer_read_max);
+    check(pool.get_alloc_count() == alloc_count + 1 && pool.get_reuse_count() == reuse_count + 1, "next read reuses pooled buffer");
+
+    // Unconsumed data larger than first buffer
+    size_t total = 0;
+    while (total < 3 * rohit::config::socket_peer_read_size) {
+        stream.reserve(rohit::config::socket_peer_read_min_free, rohit::config::socket_peer_read_max);
+        const size_t size = stream.tail_size();
+        for (size_t index = 0; index < size; ++index) stream.tail()[index] = static_cast<uint8_t>(total + index);
+        stream.commit(size);
+        total += size;
+    }
+    bool in_order = stream.size() == total;
+    for (size_t index = 0; in_order && index < total; ++index) in_order = stream.data()[index] == static_cast<uint8_t>(index);
+    check(in_order, "grown buffer keeps data in order");
+
+    check(!stream.reserve(rohit::config::socket_peer_read_max, rohit::config::socket_peer_read_max), "limit is enforced");
+    stream.reset();
+}
+
+void test_frame_length() {
+    rohit::message::Command command { };
+    const uint8_t *buffer = reinterpret_cast<const uint8_t *>(&command);
+    check(rohit::message::frame_length(buffer, 1) == 0, "code is not complete");
+    check(rohit::message::frame_length(buffer, sizeof(rohit::message::Base)) == 0, "command count is not complete");
+    command.add(rohit::guid_t { }, 1, rohit::message::Operation::Code::SWITCH, 1);
+    command.add(rohit::guid_t { }, 2, rohit::message::Operation::Code::LEVEL, 3);
+    check(rohit::message::frame_length(buffer, sizeof(command)) == command.length(), "command length from count");
+
+    const rohit::message::KeepAlive keep_alive { };
+    check(rohit::message::frame_length(reinterpret_cast<const uint8_t *>(&keep_alive), sizeof(keep_alive)) == sizeof(keep_alive), "fixed message length");
+}
+
+// Two messages and half of third in one read, rest of it in next read
+void test_reassembly() {
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds);
+    rohit::socket_t socket(fds[0]);
+    receive_peer peer(socket);
+
+    rohit::message::Command command { };
+    for (int index = 0; index < 5; ++index) {
+        command.add(rohit::guid_t { }, index, rohit::message::Operation::Code::SWITCH, 1);
+    }
+    const rohit::message::KeepAlive keep_alive { };
+
+    std::vector<uint8_t> stream;
+    auto append = [&stream](const void *message, const size_t size) {
+        stream.insert(stream.end(), (const uint8_t *)message, (const uint8_t *)message + size);
+    };
+    append(&keep_alive, sizeof(keep_alive));
+    append(&command, command.length());
+    append(&command, command.length());
+    append(&keep_alive, sizeof(keep_alive));
+
+    const size_t split = sizeof(keep_alive) + command.length() + command.length() / 2;
+    ::send(fds[1], stream.data(), split, 0);
+    check(peer.read_messages() == rohit::err_t::SUCCESS, "first read");
+    check(peer.codes.size() == 2, "complete messages of first read");
+    check(peer.pending() == command.length() / 2, "partial message is kept");
+
+    ::send(fds[1], stream.data() + split, stream.size() - split, 0);
+    peer.read_messages();
+    check(peer.codes.size() == 4, "message spanning reads is completed");
+    check(peer.codes.size() == 4 &&
+          peer.codes[0] == rohit::message::Code::KEEP_ALIVE &&
+          peer.codes[1] == rohit::message::Code::COMMAND &&
+          peer.codes[2] == rohit::message::Code::COMMAND &&
+          peer.codes[3] == rohit::message::Code::KEEP_ALIVE, "messages in order");
+    check(peer.capacity() == 0, "idle connection holds no buffer");
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+// One byte at a time, every message is still seen once
+void test_byte_stream() {
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds);
+    rohit::socket_t socket(fds[0]);
+    receive_peer peer(socket);
+
+    rohit::message::Command command { };
+    command.add(rohit::guid_t { }, 7, rohit::message::Operation::Code::LEVEL, 9);
+    const uint8_t *buffer = reinterpret_cast<const uint8_t *>(&command);
+    for (int repeat = 0; repeat < 3; ++repeat) {
+        for (size_t index = 0; index < command.length(); ++index) {
+            ::send(fds[1], buffer + index, 1, 0);
+            peer.read_messages();
+        }
+    }
+    check(peer.codes.size() == 3, "byte stream gives every message");
+    check(peer.pending() == 0, "nothing left after byte stream");
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+// Data that is never consumed stops at limit
+void test_limit() {
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds);
+    rohit::socket_t socket(fds[0]);
+    receive_peer peer(socket);
+
+    std::vector<uint8_t> data(64 * 1024, 0xff);
+    auto err = rohit::err_t::SUCCESS;
+    for (int round = 0; err == rohit::err_t::SUCCESS && round < 100; ++round) {
+        ::send(fds[1], data.data(), data.size(), MSG_DONTWAIT);
+        size_t read_length { };
+        while ((err = peer.receive(read_length)) == rohit::err_t::SUCCESS && read_length != 0);
+        if (err == rohit::err_t::RECEIVE_FAILURE) err = rohit::err_t::SUCCESS;
+    }
+    check(err == rohit::err_t::SOCKET_READ_BUFFER_FULL, "unconsumed data is limited");
+    check(peer.pending() <= rohit::config::socket_peer_read_max, "limit is not exceeded");
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+int main() {
+    rohit::init_iot("/tmp/iotcloud_testreceive.log");
+
+    test_stream_buffer();
+    test_frame_length();
+    test_reassembly();
+    test_byte_stream();
+    test_limit();
+
+    rohit::destroy_iot();
+
+    return test_summary();
+}
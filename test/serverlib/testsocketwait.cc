@@ -0,0 +1,132 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <iot/net/socket.hh>
+#include <iot/init.hh>
+#include <testcheck.hh>
+#include <csignal>
+#include <iostream>
+#include <sys/socket.h>
+#include <thread>
+
+int64_t elapsed_ms(const std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Socket buffer is filled so that next write has to wait
+void fill(const int fd) {
+    uint8_t buffer[4096] { };
+    while (::write(fd, buffer, sizeof(buffer)) > 0) { }
+}
+
+void drain(const int fd) {
+    uint8_t buffer[4096];
+    while (::read(fd, buffer, sizeof(buffer)) > 0) { }
+}
+
+void test_ready() {
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds);
+    rohit::socket_t socket(fds[0]);
+
+    const auto start = std::chrono::steady_clock::now();
+    size_t sent = 0;
+    check(socket.write_wait("hello", 5, sent, 1000) == rohit::err_t::SUCCESS, "ready socket is written");
+    check(sent == 5, "whole buffer written");
+    check(elapsed_ms(start) < 100, "ready socket does not wait");
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+void test_timeout() {
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds);
+    rohit::socket_t socket(fds[0]);
+    fill(fds[0]);
+
+    const auto start = std::chrono::steady_clock::now();
+    size_t sent = 0;
+    check(socket.write_wait("hello", 5, sent, 100) == rohit::err_t::SOCKET_WAIT_TIMEOUT, "full socket times out");
+    const auto elapsed = elapsed_ms(start);
+    check(elapsed >= 100 && elapsed < 500, "timeout is bounded by deadline");
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+void test_wakeup() {
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds);
+    rohit::socket_t socket(fds[0]);
+    fill(fds[0]);
+
+    // Writer is woken as soon as reader makes room, not on next retry tick
+    std::thread reader([fd = fds[1]]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        drain(fd);
+    });
+
+    const auto start = std::chrono::steady_clock::now();
+    size_t sent = 0;
+    check(socket.write_wait("hello", 5, sent, 2000) == rohit::err_t::SUCCESS, "waiting write completes");
+    check(elapsed_ms(start) < 1000, "write resumes once drained");
+    reader.join();
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+void test_closed() {
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds);
+    rohit::socket_t socket(fds[0]);
+    ::close(fds[1]);
+
+    size_t sent = 0;
+    signal(SIGPIPE, SIG_IGN);
+    check(socket.write_wait("hello", 5, sent, 1000) == rohit::err_t::SEND_FAILURE, "closed peer fails without waiting");
+
+    ::close(fds[0]);
+}
+
+void test_empty() {
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds);
+    rohit::socket_t socket(fds[0]);
+
+    // Nothing to write, socket stays writable and must not be retried
+    const auto start = std::chrono::steady_clock::now();
+    size_t sent = 1;
+    check(socket.write_wait("hello", 0, sent, 1000) == rohit::err_t::SUCCESS, "empty write succeeds");
+    check(sent == 0, "nothing written");
+    check(elapsed_ms(start) < 100, "empty write does not wait");
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+int main() {
+    rohit::init_iot("/tmp/iotcloud_testsocketwait.log");
+
+    test_ready();
+    test_timeout();
+    test_wakeup();
+    test_closed();
+    test_empty();
+
+    rohit::destroy_iot();
+
+    return test_summary();
+}
@@ -0,0 +1,148 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <iot/states/event_distributor.hh>
+#include <iot/watcher/helperevent.hh>
+#include <iot/init.hh>
+#include <testcheck.hh>
+#include <iostream>
+#include <sys/eventfd.h>
+#include <thread>
+#include <vector>
+
+template <typename PRED>
+bool wait_for(PRED pred) {
+    for(int count = 0; count < 500; ++count) {
+        if (pred()) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return pred();
+}
+
+void test_post_to_thread(rohit::event_distributor &evtdist) {
+    const auto thread_count = evtdist.get_thread_count();
+    std::vector<std::atomic<size_t>> ran_on(thread_count);
+    for(auto &value: ran_on) value = SIZE_MAX;
+
+    for(size_t thread_index = 0; thread_index < thread_count; ++thread_index) {
+        evtdist.post(thread_index, [&ran_on, thread_index] {
+            ran_on[thread_index] = rohit::ctx.get_thread_index();
+        });
+    }
+
+    check(wait_for([&] {
+        for(auto &value: ran_on) if (value == SIZE_MAX) return false;
+        return true;
+    }), "all posted tasks ran");
+
+    bool same_thread = true;
+    for(size_t thread_index = 0; thread_index < thread_count; ++thread_index) {
+        if (ran_on[thread_index] != thread_index) same_thread = false;
+    }
+    check(same_thread, "task ran on thread it was posted to");
+}
+
+void test_order_and_producers(rohit::event_distributor &evtdist) {
+    static constexpr size_t producer_count = 4;
+    static constexpr size_t task_per_producer = 10000;
+
+    std::atomic<size_t> ran_count { 0 };
+    std::vector<size_t> last_sequence(producer_count, 0);
+    std::atomic<bool> in_order { true };
+
+    std::vector<std::thread> producers;
+    for(size_t producer = 0; producer < producer_count; ++producer) {
+        producers.emplace_back([&, producer] {
+            for(size_t sequence = 1; sequence <= task_per_producer; ++sequence) {
+                evtdist.post(0, [&, producer, sequence] {
+                    // Only thread 0 runs these, no lock is required
+                    if (last_sequence[producer] + 1 != sequence) in_order = false;
+                    last_sequence[producer] = sequence;
+                    ++ran_count;
+                });
+            }
+        });
+    }
+    for(auto &producer: producers) producer.join();
+
+    check(wait_for([&] { return ran_count == producer_count * task_per_producer; }), "every task ran once");
+    check(in_order, "tasks of one producer ran in order");
+}
+
+class idle_executor : public rohit::event_executor {
+public:
+    const int fd { eventfd(0, EFD_NONBLOCK) };
+
+    ~idle_executor() { ::close(fd); }
+
+protected:
+    void execute() override { }
+    void flush() override { }
+    void close() override { }
+};
+
+// Executor added to last shard is removed by thread of first shard
+void test_remove_from_other_shard(rohit::event_distributor &evtdist) {
+    idle_executor executor { };
+    evtdist.add_shard(evtdist.get_shard_count() - 1, executor.fd, EPOLLIN, &executor);
+
+    std::atomic<int> removed { -1 };
+    evtdist.post(0, [&] {
+        removed = rohit::isFailure(evtdist.remove(executor.fd, &executor)) ? 0 : 1;
+    });
+    check(wait_for([&] { return removed != -1; }) && removed == 1, "executor removed from its own shard");
+}
+
+class freed_executor : public rohit::event_executor {
+public:
+    std::atomic<bool> &freed;
+
+    freed_executor(std::atomic<bool> &freed) : freed(freed) { }
+    ~freed_executor() { freed = true; }
+
+protected:
+    void execute() override { }
+    void flush() override { }
+    void close() override { }
+};
+
+// Other loop thread is blocked without timeout, retire wakes it so that
+// epoch moves and executor is freed
+void test_free_with_idle_thread(rohit::event_distributor &evtdist) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    std::atomic<bool> freed { false };
+    evtdist.post(0, [&] {
+        rohit::ctx.delayed_free(new freed_executor(freed));
+    });
+    check(wait_for([&] { return freed.load(); }), "retired executor freed while other thread is idle");
+}
+
+int main() {
+    rohit::init_iot("/tmp/iotcloud_testtaskqueue.log");
+    {
+        rohit::event_distributor evtdist(2, rohit::event_mode_t::SHARDED);
+        evtdist.init();
+
+        test_post_to_thread(evtdist);
+        test_order_and_producers(evtdist);
+        test_remove_from_other_shard(evtdist);
+        test_free_with_idle_thread(evtdist);
+
+        evtdist.terminate();
+        evtdist.wait();
+    }
+    rohit::destroy_iot();
+
+    return test_summary();
+}
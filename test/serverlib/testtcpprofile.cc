@@ -0,0 +1,110 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <iot/net/socket.hh>
+#include <iot/init.hh>
+#include <testcheck.hh>
+#include <iostream>
+#include <poll.h>
+
+constexpr int test_port = 18234;
+constexpr int accept_timeout_in_ms = 5000;
+
+// Missed connection fails test instead of blocking it in accept
+bool wait_readable(const int fd, const int timeout_in_ms) {
+    pollfd entry { fd, POLLIN, 0 };
+    return poll(&entry, 1, timeout_in_ms) == 1 && (entry.revents & POLLIN) != 0;
+}
+
+void test_default() {
+    rohit::server_socket_t server(test_port);
+    check(server.set_tcp_profile(rohit::tcp_profile { }), "empty profile sets nothing");
+    check(server.get_option(IPPROTO_TCP, TCP_NODELAY) == 0, "nodelay stays off");
+    check(server.get_option(SOL_SOCKET, SO_KEEPALIVE) == 0, "keepalive stays off");
+    server.close();
+}
+
+void test_profile() {
+    rohit::tcp_profile profile { };
+    profile.nodelay = true;
+    profile.defer_accept_in_s = 5;
+    profile.keepalive_idle_in_s = 120;
+    profile.keepalive_interval_in_s = 15;
+    profile.keepalive_count = 3;
+    profile.user_timeout_in_ms = 30000;
+    profile.notsent_lowat = 65536;
+    profile.receive_buffer_size = 8192;
+    profile.send_buffer_size = 8192;
+
+    rohit::server_socket_t server(test_port);
+    check(server.set_tcp_profile(profile), "profile set on listener");
+    check(server.get_option(IPPROTO_TCP, TCP_DEFER_ACCEPT) > 0, "listener defers accept");
+    check(server.get_receive_buffer_size() == 8192, "listener receive buffer");
+    check(server.get_send_buffer_size() == 8192, "listener send buffer");
+
+    // Defer accept waits for data, request is sent right after connect
+    rohit::client_socket_t client(rohit::ipv6_socket_addr_t("::1", test_port));
+    size_t sent = 0;
+    check(client.write("x", 1, sent) == rohit::err_t::SUCCESS && sent == 1, "request sent");
+    server.set_non_blocking();
+    const bool ready = wait_readable(server, accept_timeout_in_ms);
+    check(ready, "connection ready within deadline");
+    if (!ready) {
+        client.close();
+        server.close();
+        return;
+    }
+    auto peer = server.accept();
+    check(!peer.is_closed(), "accepted after data");
+
+    check(peer.get_option(IPPROTO_TCP, TCP_NODELAY) != 0, "accepted inherits nodelay");
+    check(peer.get_option(SOL_SOCKET, SO_KEEPALIVE) != 0, "accepted inherits keepalive");
+    check(peer.get_option(IPPROTO_TCP, TCP_KEEPIDLE) == 120, "accepted inherits keepalive idle");
+    check(peer.get_option(IPPROTO_TCP, TCP_KEEPINTVL) == 15, "accepted inherits keepalive interval");
+    check(peer.get_option(IPPROTO_TCP, TCP_KEEPCNT) == 3, "accepted inherits keepalive count");
+    check(peer.get_option(IPPROTO_TCP, TCP_USER_TIMEOUT) == 30000, "accepted inherits user timeout");
+    check(peer.get_option(IPPROTO_TCP, TCP_NOTSENT_LOWAT) == 65536, "accepted inherits not sent low watermark");
+    check(peer.get_send_buffer_size() == 8192, "accepted inherits send buffer");
+
+    peer.set_cork(true);
+    check(peer.get_option(IPPROTO_TCP, TCP_CORK) != 0, "cork set");
+    peer.set_cork(false);
+    check(peer.get_option(IPPROTO_TCP, TCP_CORK) == 0, "cork cleared");
+
+    peer.close();
+    client.close();
+    server.close();
+}
+
+void test_clamp() {
+    // Far above any net.core.wmem_max, kernel silently clamps
+    rohit::tcp_profile profile { };
+    profile.send_buffer_size = 1024 * 1024 * 1024;
+    rohit::server_socket_t server(test_port);
+    check(server.set_tcp_profile(profile), "oversized buffer is not failure");
+    check(server.get_send_buffer_size() < profile.send_buffer_size, "oversized buffer is clamped");
+    server.close();
+}
+
+int main() {
+    rohit::init_iot("/tmp/iotcloud_testtcpprofile.log");
+
+    test_default();
+    test_profile();
+    test_clamp();
+
+    rohit::destroy_iot();
+
+    return test_summary();
+}
@@ -0,0 +1,166 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <iot/states/event_distributor.hh>
+#include <iot/states/timer_wheel.hh>
+#include <testcheck.hh>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+class test_executor : public rohit::event_executor {
+public:
+    rohit::event_timer timer;
+    uint64_t armed_at_in_ms { 0 };
+    uint64_t expected_in_ms { 0 };
+    uint64_t fired_at_in_ms { 0 };
+    int fired_count { 0 };
+
+    test_executor() : timer(this) { }
+
+    static uint64_t now_in_ms() {
+        const auto now = std::chrono::steady_clock::now().time_since_epoch();
+        return std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+    }
+
+    void arm(rohit::timer_wheel &wheel, const uint64_t timeout_in_ms) {
+        armed_at_in_ms = now_in_ms();
+        expected_in_ms = timeout_in_ms;
+        wheel.arm(timer, timeout_in_ms);
+    }
+
+private:
+    void execute() override { }
+    void flush() override { }
+    void close() override { }
+
+    void timeout(rohit::event_timer *) override {
+        fired_at_in_ms = now_in_ms();
+        ++fired_count;
+    }
+};
+
+void run_wheel(rohit::timer_wheel &wheel, const uint64_t duration_in_ms) {
+    const auto end_in_ms = test_executor::now_in_ms() + duration_in_ms;
+    while(test_executor::now_in_ms() < end_in_ms) {
+        auto timeout = wheel.next_timeout_in_ms();
+        if (timeout < 0 || timeout > 50) timeout = 50;
+        std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
+        wheel.advance();
+    }
+}
+
+void test_expiry() {
+    std::cout << "Test expiry on level 0 and level 1" << std::endl;
+    rohit::timer_wheel wheel;
+    std::vector<test_executor> executors(6);
+    const uint64_t timeouts[] { 1, 20, 55, 300, 650, 1200 };
+    for(size_t index = 0; index < executors.size(); ++index) {
+        executors[index].arm(wheel, timeouts[index]);
+    }
+    check(wheel.get_timer_count() == executors.size(), "timer count after arm");
+
+    run_wheel(wheel, 1500);
+
+    for(auto &executor: executors) {
+        check(executor.fired_count == 1, "fired once");
+        const auto elapsed = executor.fired_at_in_ms - executor.armed_at_in_ms;
+        check(elapsed + rohit::config::timer_tick_in_ms >= executor.expected_in_ms, "not fired early");
+        check(elapsed <= executor.expected_in_ms + 4 * rohit::config::timer_tick_in_ms + 50, "not fired late");
+    }
+    check(wheel.get_timer_count() == 0, "timer count after expiry");
+}
+
+void test_cancel_and_rearm() {
+    std::cout << "Test cancel and re-arm" << std::endl;
+    rohit::timer_wheel wheel;
+    test_executor cancelled;
+    test_executor rearmed;
+    cancelled.arm(wheel, 50);
+    rearmed.arm(wheel, 50);
+    const auto remaining = rohit::timer_wheel::remaining_in_ms(rearmed.timer);
+    check(remaining > 0 && remaining <= 50 + rohit::config::timer_tick_in_ms, "remaining time of armed timer");
+
+    rohit::timer_wheel::disarm(cancelled.timer);
+    check(!cancelled.timer.is_armed(), "disarm");
+    check(rohit::timer_wheel::remaining_in_ms(cancelled.timer) == 0, "no remaining time once disarmed");
+    rearmed.arm(wheel, 400);
+
+    run_wheel(wheel, 200);
+    check(cancelled.fired_count == 0, "cancelled timer not fired");
+    check(rearmed.fired_count == 0, "re-armed timer not fired at old deadline");
+
+    run_wheel(wheel, 400);
+    check(rearmed.fired_count == 1, "re-armed timer fired at new deadline");
+}
+
+void test_busy_executor() {
+    std::cout << "Test timeout of executor busy in other thread" << std::endl;
+    rohit::timer_wheel wheel;
+    test_executor busy;
+    test_executor cancelled;
+
+    // Executor is held as if it is running in other thread
+    busy.enter_loop();
+    cancelled.enter_loop();
+    busy.arm(wheel, 20);
+    cancelled.arm(wheel, 20);
+
+    run_wheel(wheel, 100);
+    check(busy.fired_count == 0, "busy executor timeout is not run");
+    check(busy.timer.is_armed(), "busy executor timer is retried");
+    check(wheel.get_timer_count() == 2, "retried timers are counted");
+
+    // Busy executor closing cancels timer, wheel must not keep it
+    rohit::timer_wheel::disarm(cancelled.timer);
+    check(!cancelled.timer.is_armed(), "cancel while retried");
+
+    // Every failed attempt is one more execute for running thread
+    while(!busy.exit_loop()) { }
+    while(!cancelled.exit_loop()) { }
+
+    run_wheel(wheel, 100);
+    check(busy.fired_count == 1, "timeout runs once executor is free");
+    check(cancelled.fired_count == 0, "cancelled timer is not retried");
+    check(wheel.get_timer_count() == 0, "no timer left after retry");
+}
+
+void test_many_timers() {
+    std::cout << "Test many timers" << std::endl;
+    rohit::timer_wheel wheel;
+    std::vector<test_executor> executors(100000);
+    for(size_t index = 0; index < executors.size(); ++index) {
+        executors[index].arm(wheel, 10 + index % 500);
+    }
+    for(size_t index = 0; index < executors.size(); index += 2) {
+        rohit::timer_wheel::disarm(executors[index].timer);
+    }
+
+    run_wheel(wheel, 800);
+    size_t fired = 0;
+    for(auto &executor: executors) fired += executor.fired_count;
+    check(fired == executors.size() / 2, "only armed timers fired");
+    check(wheel.get_timer_count() == 0, "no timer left");
+}
+
+int main() {
+    std::cout << "sizeof(event_timer) = " << sizeof(rohit::event_timer) << std::endl;
+    check(sizeof(rohit::event_timer) <= 32, "timer fits in 32 bytes");
+    test_expiry();
+    test_cancel_and_rearm();
+    test_busy_executor();
+    test_many_timers();
+
+    return test_summary();
+}
@@ -0,0 +1,183 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <iot/net/serverevent.hh>
+#include <iot/init.hh>
+#include <testcheck.hh>
+#include <iostream>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <vector>
+
+// Peer is driven directly over socketpair without event loop
+class write_peer : public rohit::serverpeerevent<false> {
+public:
+    using rohit::serverpeerevent<false>::serverpeerevent;
+    using rohit::serverpeerevent<false>::write_all;
+    using rohit::serverpeerevent<false>::push_write_file;
+
+    void queue(const uint8_t first, const size_t size) {
+        auto buffer = rohit::io_buffer::alloc(size);
+        for(size_t index = 0; index < size; ++index) buffer->data()[index] = static_cast<uint8_t>(first + index);
+        push_write(buffer, size);
+    }
+
+protected:
+    void execute() override { }
+};
+
+// Expected stream is concatenation of all queued entries
+void append_expected(std::vector<uint8_t> &expected, const uint8_t first, const size_t size) {
+    for(size_t index = 0; index < size; ++index) expected.push_back(static_cast<uint8_t>(first + index));
+}
+
+void read_available(const int fd, std::vector<uint8_t> &received) {
+    uint8_t buffer[64 * 1024];
+    while(true) {
+        auto ret = ::recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (ret <= 0) break;
+        received.insert(received.end(), buffer, buffer + ret);
+    }
+}
+
+void test_gather() {
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds);
+    rohit::socket_t socket(fds[0]);
+    write_peer peer(socket);
+
+    std::vector<uint8_t> expected;
+    for(int index = 0; index < 100; ++index) {
+        peer.queue(index, 17);
+        append_expected(expected, index, 17);
+    }
+    peer.write_all();
+
+    std::vector<uint8_t> received;
+    read_available(fds[1], received);
+    check(!peer.is_write_left(), "all entries written");
+    check(peer.get_flush_count() == 1, "100 entries written by one syscall");
+    check(received == expected, "gathered bytes in queue order");
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+void test_partial() {
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds);
+    const int buffer_size = 4096;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+    rohit::socket_t socket(fds[0]);
+    write_peer peer(socket);
+
+    // Entry sizes chosen so that socket fills in the middle of entries
+    std::vector<uint8_t> expected;
+    for(int index = 0; index < 40; ++index) {
+        const size_t size = 1000 + index * 37;
+        peer.queue(index * 3, size);
+        append_expected(expected, index * 3, size);
+    }
+
+    std::vector<uint8_t> received;
+    peer.write_all();
+    check(peer.is_write_left(), "socket full leaves entries queued");
+    check(peer.get_client_state() == rohit::state_t::SOCKET_PEER_WRITE, "partial write waits for writable");
+
+    int rounds = 0;
+    while(peer.is_write_left() && rounds < 10000) {
+        read_available(fds[1], received);
+        peer.write_all();
+        ++rounds;
+    }
+    read_available(fds[1], received);
+    check(!peer.is_write_left(), "partial writes complete");
+    check(received == expected, "partial writes resume at right offset");
+    check(peer.get_flush_count() < 40 + static_cast<uint64_t>(rounds), "entries batched across partial writes");
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+// Body larger than socket buffer with header before and trailer after it
+void test_sendfile() {
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds);
+    const int buffer_size = 4096;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+    rohit::socket_t socket(fds[0]);
+    write_peer peer(socket);
+
+    constexpr size_t body_size = 200 * 1024;
+    std::vector<uint8_t> body;
+    append_expected(body, 7, body_size);
+    const int file_fd = memfd_create("testwritev", MFD_CLOEXEC);
+    check(::write(file_fd, body.data(), body.size()) == static_cast<ssize_t>(body.size()), "file created");
+    auto owner = std::make_shared<int>(0);
+
+    std::vector<uint8_t> expected;
+    peer.queue(1, 100);
+    append_expected(expected, 1, 100);
+    peer.push_write_file(file_fd, body_size, owner);
+    expected.insert(expected.end(), body.begin(), body.end());
+    peer.queue(9, 50);
+    append_expected(expected, 9, 50);
+    check(owner.use_count() == 2, "file entry holds owner");
+
+    std::vector<uint8_t> received;
+    int rounds = 0;
+    peer.write_all();
+    while(peer.is_write_left() && rounds < 100000) {
+        read_available(fds[1], received);
+        peer.write_all();
+        ++rounds;
+    }
+    read_available(fds[1], received);
+    check(!peer.is_write_left(), "file entry written");
+    check(received == expected, "file body between header and trailer");
+    check(owner.use_count() == 1, "owner released after file entry written");
+    check(lseek(file_fd, 0, SEEK_CUR) == static_cast<off_t>(body_size), "file offset not used by sendfile");
+
+    ::close(file_fd);
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+void test_failure() {
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds);
+    ::close(fds[1]);
+    rohit::socket_t socket(fds[0]);
+    write_peer peer(socket);
+
+    for(int index = 0; index < 10; ++index) peer.queue(index, 10);
+    peer.write_all();
+    check(!peer.is_write_left(), "failed batch removed from queue");
+
+    ::close(fds[0]);
+}
+
+int main() {
+    rohit::init_iot("/tmp/iotcloud_testwritev.log");
+
+    test_gather();
+    test_partial();
+    test_sendfile();
+    test_failure();
+
+    rohit::destroy_iot();
+
+    return test_summary();
+}
@@ -0,0 +1,163 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// Author: Rohit Jairaj Singh (rohit@singh.org.in)                                         //
+// This program is free software: you can redistribute it and/or modify it under the terms //
+// of the GNU General Public License as published by the Free Software Foundation, either  //
+// version 3 of the License, or (at your option) any later version.                        //
+//                                                                                         //
+// This program is distributed in the hope that it will be useful, but WITHOUT ANY         //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A         //
+// PARTICULAR PURPOSE. See the GNU General Public License for more details.                //
+//                                                                                         //
+// You should have received a copy of the GNU General Public License along with this       //
+// program. If not, see <https://www.gnu.org/licenses/>.                                   //
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <iot/net/serverevent.hh>
+#include <iot/init.hh>
+#include <testcheck.hh>
+#include <iostream>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <vector>
+
+// Peer is driven directly over connected socket without event loop
+class zerocopy_peer : public rohit::serverpeerevent<false> {
+public:
+    using rohit::serverpeerevent<false>::serverpeerevent;
+    using rohit::serverpeerevent<false>::write_all;
+    using rohit::serverpeerevent<false>::can_read;
+
+protected:
+    void execute() override { }
+};
+
+// Zerocopy needs TCP, loopback pair of server and client fd
+bool tcp_pair(int &server_fd, int &client_fd) {
+    const int listen_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr { };
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    if (::bind(listen_fd, (sockaddr *)&addr, sizeof(addr)) != 0 || ::listen(listen_fd, 1) != 0) return false;
+    ::getsockname(listen_fd, (sockaddr *)&addr, &addr_len);
+
+    client_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (::connect(client_fd, (sockaddr *)&addr, sizeof(addr)) != 0) return false;
+    server_fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK);
+    ::close(listen_fd);
+    return server_fd >= 0;
+}
+
+void read_all(const int fd, std::vector<uint8_t> &received, const size_t size) {
+    uint8_t buffer[64 * 1024];
+    while (received.size() < size) {
+        auto ret = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (ret <= 0) break;
+        received.insert(received.end(), buffer, buffer + ret);
+    }
+}
+
+// Completion is reaped on next event of peer
+bool wait_released(zerocopy_peer &peer, const int fd) {
+    for (int round = 0; round < 100 && peer.get_zerocopy_held() != 0; ++round) {
+        pollfd pfd { fd, 0, 0 };
+        ::poll(&pfd, 1, 10);
+        peer.can_read();
+    }
+    return peer.get_zerocopy_held() == 0;
+}
+
+rohit::io_buffer *make_buffer(const size_t size, const uint8_t first) {
+    auto buffer = rohit::io_buffer::alloc(size);
+    for (size_t index = 0; index < size; ++index) buffer->data()[index] = static_cast<uint8_t>(first + index);
+    return buffer;
+}
+
+void test_unsupported() {
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds);
+    rohit::socket_t socket(fds[0]);
+    zerocopy_peer peer(socket);
+    peer.set_zerocopy(4096);
+    check(!peer.is_zerocopy(), "unix socket sends copy");
+    check(!peer.has_error_queue(), "no error queue without zerocopy");
+
+    auto buffer = make_buffer(16 * 1024, 1);
+    peer.push_write(buffer->share(), 16 * 1024);
+    peer.write_all();
+    check(peer.get_zerocopy_held() == 0 && buffer->use_count() == 1, "copied buffer is released after write");
+    buffer->release();
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+void test_zerocopy() {
+    int server_fd, client_fd;
+    if (!tcp_pair(server_fd, client_fd)) {
+        check(false, "loopback connection");
+        return;
+    }
+    rohit::socket_t socket(server_fd);
+    zerocopy_peer peer(socket);
+    peer.set_zerocopy(32 * 1024);
+    if (!peer.is_zerocopy()) {
+        std::cout << "Zerocopy not supported by kernel, skipping" << std::endl;
+        ::close(server_fd);
+        ::close(client_fd);
+        return;
+    }
+    check(peer.has_error_queue(), "error queue is executed");
+
+    // Small header and large body go in one send, both are held
+    auto header = make_buffer(100, 7);
+    auto body = make_buffer(128 * 1024, 9);
+    peer.push_write(header->share(), 100);
+    peer.push_write(body->share(), 128 * 1024);
+    peer.write_all();
+
+    std::vector<uint8_t> expected(header->data(), header->data() + 100);
+    expected.insert(expected.end(), body->data(), body->data() + 128 * 1024);
+
+    std::vector<uint8_t> received;
+    while (peer.is_write_left()) {
+        read_all(client_fd, received, received.size() + 1);
+        peer.write_all();
+    }
+    check(!peer.is_write_left(), "written from write queue");
+    check(body->use_count() > 1, "kernel send holds body after write queue");
+
+    read_all(client_fd, received, expected.size());
+    check(received == expected, "zerocopy bytes in order");
+
+    check(wait_released(peer, server_fd), "completion releases held buffers");
+    check(header->use_count() == 1 && body->use_count() == 1, "only caller reference left");
+
+    // Buffer below threshold alone is copied
+    auto small = make_buffer(1024, 3);
+    peer.push_write(small->share(), 1024);
+    peer.write_all();
+    check(small->use_count() == 1, "small buffer is not held");
+    received.clear();
+    read_all(client_fd, received, 1024);
+
+    header->release();
+    body->release();
+    small->release();
+
+    ::close(server_fd);
+    ::close(client_fd);
+}
+
+int main() {
+    rohit::init_iot("/tmp/iotcloud_testzerocopy.log");
+
+    test_unsupported();
+    test_zerocopy();
+
+    rohit::destroy_iot();
+
+    return test_summary();
+}